@@ -4,12 +4,14 @@
  * Rules:
  * - `sheet` is mandatory and must be:
  *   - telemetry_logs
+ *   - telemetry_aggregates
  *   - access_logs
  * - Snake_case fields only.
  * - No legacy/fallback routing.
  */
 
 const TELEMETRY_SHEET = "telemetry_logs";
+const TELEMETRY_AGG_SHEET = "telemetry_aggregates";
 const ACCESS_SHEET = "access_logs";
 
 const TELEMETRY_HEADERS = [
@@ -26,6 +28,22 @@ const TELEMETRY_HEADERS = [
   "stage2_threshold",
 ];
 
+const TELEMETRY_AGG_HEADERS = [
+  "period_start",
+  "period_end",
+  "device_id",
+  "sample_count",
+  "temperature_min_c",
+  "temperature_max_c",
+  "temperature_avg_c",
+  "humidity_min_pct",
+  "humidity_max_pct",
+  "humidity_avg_pct",
+  "fan1_on_fraction",
+  "fan2_on_fraction",
+  "any_alarm",
+];
+
 const ACCESS_HEADERS = [
   "timestamp",
   "device_id",
@@ -54,10 +72,7 @@ function handleRequest(e) {
     const sheet = ensureSheet(ss, sheetName);
     ensureHeaders(sheet, sheetName);
 
-    const row =
-      sheetName === ACCESS_SHEET
-        ? buildAccessRow(params)
-        : buildTelemetryRow(params);
+    const row = buildRow(sheetName, params);
 
     sheet.appendRow(row);
     return jsonOutput({
@@ -93,7 +108,11 @@ function readParams(e) {
 
 function requireSheet(params) {
   const sheet = String(params.sheet || "").trim();
-  if (sheet !== TELEMETRY_SHEET && sheet !== ACCESS_SHEET) {
+  if (
+    sheet !== TELEMETRY_SHEET &&
+    sheet !== TELEMETRY_AGG_SHEET &&
+    sheet !== ACCESS_SHEET
+  ) {
     throw new Error("invalid or missing sheet");
   }
   return sheet;
@@ -105,8 +124,20 @@ function ensureSheet(ss, sheetName) {
   return sheet;
 }
 
+function headersFor(sheetName) {
+  if (sheetName === ACCESS_SHEET) return ACCESS_HEADERS;
+  if (sheetName === TELEMETRY_AGG_SHEET) return TELEMETRY_AGG_HEADERS;
+  return TELEMETRY_HEADERS;
+}
+
+function buildRow(sheetName, params) {
+  if (sheetName === ACCESS_SHEET) return buildAccessRow(params);
+  if (sheetName === TELEMETRY_AGG_SHEET) return buildTelemetryAggregateRow(params);
+  return buildTelemetryRow(params);
+}
+
 function ensureHeaders(sheet, sheetName) {
-  const headers = sheetName === ACCESS_SHEET ? ACCESS_HEADERS : TELEMETRY_HEADERS;
+  const headers = headersFor(sheetName);
   const range = sheet.getRange(1, 1, 1, headers.length);
   const current = range.getValues()[0];
 
@@ -136,6 +167,24 @@ function buildTelemetryRow(params) {
   ];
 }
 
+function buildTelemetryAggregateRow(params) {
+  return [
+    normalizeTimestamp(params.period_start),
+    normalizeTimestamp(params.period_end),
+    requireString(params.device_id, "device_id"),
+    toNumber(params.sample_count, "sample_count"),
+    toNumber(params.temperature_min_c, "temperature_min_c"),
+    toNumber(params.temperature_max_c, "temperature_max_c"),
+    toNumber(params.temperature_avg_c, "temperature_avg_c"),
+    toNumber(params.humidity_min_pct, "humidity_min_pct"),
+    toNumber(params.humidity_max_pct, "humidity_max_pct"),
+    toNumber(params.humidity_avg_pct, "humidity_avg_pct"),
+    toFraction(params.fan1_on_fraction, "fan1_on_fraction"),
+    toFraction(params.fan2_on_fraction, "fan2_on_fraction"),
+    toBooleanText(params.any_alarm),
+  ];
+}
+
 function buildAccessRow(params) {
   return [
     normalizeTimestamp(params.timestamp),
@@ -182,6 +231,12 @@ function toNumber(value, fieldName) {
   return n;
 }
 
+function toFraction(value, fieldName) {
+  const n = toNumber(value, fieldName);
+  if (n < 0 || n > 1) throw new Error("fraction out of range: " + fieldName);
+  return n;
+}
+
 function toBooleanText(value) {
   const raw = String(value || "").toLowerCase();
   if (raw === "true" || raw === "1" || raw === "on") return "true";
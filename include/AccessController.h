@@ -1,10 +1,13 @@
 #pragma once
 
 #include "Config.h"
+#include "EventBus.h"
+#include "SpscQueue.h"
 
 #include <Arduino.h>
 #include <Keypad.h>
-#include <deque>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <memory>
 
 #ifdef CLOSED
@@ -23,12 +26,23 @@ enum class AccessEventType : uint8_t {
 
 struct AccessEvent {
   AccessEventType type = AccessEventType::AccessDenied;
-  String userId;
-  String displayName;
-  String result;
-  String reason;
   uint8_t failedCount = 0;
   uint32_t lockoutUntilEpoch = 0;
+  uint32_t epoch = 0;
+  uint32_t atMs = 0;
+  char userId[24] = {};
+  char displayName[32] = {};
+};
+
+const char* accessResultName(AccessEventType type);
+const char* accessReasonName(AccessEventType type);
+
+bool isValidPinFormat(const String& pin);
+String hashPinSha256(const String& pin);
+
+struct KeyEvent {
+  char key = NO_KEY;
+  int64_t tsUs = 0;
 };
 
 struct AuthResult {
@@ -43,7 +57,10 @@ class AccessController {
   void begin(ConfigManager* config);
   void update();
 
-  char getKey();
+  bool nextKey(KeyEvent& out);
+  [[nodiscard]] uint32_t keyEventsDropped() const {
+    return _keyEvents.dropped();
+  }
   AuthResult validatePin(const String& pin);
   bool changePin(const String& userId, const String& newPin, String& error);
   String generateUserId() const;
@@ -54,18 +71,22 @@ class AccessController {
   [[nodiscard]] const String& lastMessage() const { return _lastMessage; }
   [[nodiscard]] const String& inputBuffer() const { return _pinBuffer; }
 
-  bool popEvent(AccessEvent& outEvent);
+  using EventBusType = EventBus<AccessEvent, 32>;
+  EventBusType& events() { return _events; }
   bool consumeUnlockRequest();
 
   bool upsertUser(const String& userId, const String& displayName,
-                  const String& pin, bool enabled, String& error);
+                  const String& pin, bool enabled, String& error,
+                  const ConfigManager::Precondition& precondition = nullptr);
 
   ConfigManager* config() const { return _config; }
 
  private:
   ConfigManager* _config = nullptr;
   std::unique_ptr<Keypad> _keypad;
-  std::deque<AccessEvent> _events;
+  SpscQueue<KeyEvent, 16> _keyEvents;
+  TaskHandle_t _scanTask = nullptr;
+  EventBusType _events;
 
   String _pinBuffer;
   String _lastMessage = "READY";
@@ -74,5 +95,8 @@ class AccessController {
   bool _lockoutWasActive = false;
   bool _unlockRequested = false;
 
-  void pushEvent(const AccessEvent& event);
+  void pushEvent(AccessEvent event);
+  static void scanTask(void* arg);
+
+  static constexpr uint32_t SCAN_PERIOD_MS = 5;
 };
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+
+enum class AdmissionVerdict : uint8_t {
+  Admitted,
+  RateLimited,
+  Busy,
+  LowHeap,
+  Count
+};
+
+struct AdmissionDecision {
+  AdmissionVerdict verdict = AdmissionVerdict::Admitted;
+  uint32_t retryAfterSec = 0;
+};
+
+struct AdmissionStats {
+  uint32_t inFlight = 0;
+  uint32_t inFlightHighWater = 0;
+  uint32_t trackedClients = 0;
+};
+
+// Gatekeeper for the web server. Each client IP gets a token bucket; admitted
+// requests hold an in-flight slot until the connection closes; everything is
+// shed while the largest free heap block is too small to build a response.
+namespace Admission {
+
+constexpr size_t VERDICT_COUNT = static_cast<size_t>(AdmissionVerdict::Count);
+constexpr uint32_t MAX_IN_FLIGHT = 6;
+constexpr uint32_t MIN_FREE_BLOCK = 12 * 1024;
+
+AdmissionDecision admit(uint32_t clientIp, uint8_t cost, bool holdsSlot);
+void release();
+
+[[nodiscard]] AdmissionStats stats();
+[[nodiscard]] uint32_t verdictCount(AdmissionVerdict verdict);
+const char* verdictName(AdmissionVerdict verdict);
+
+}  // namespace Admission
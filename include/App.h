@@ -46,13 +46,19 @@ class App {
   String _authDisplayName;
   String _selectedUserId;
   String _autoUserId;
+  String _serialLine;
   uint8_t _changePinStep = 0;
   uint8_t _userListAction = 0;
   unsigned long _uiIdleMs = 0;
   unsigned long _unlockOkMs = 0;
+  int64_t _lastKeyTsUs = 0;
+  AccessController::EventBusType::Subscription _displayEvents;
+  char _accessBanner[21] = "READY";
 
   static constexpr unsigned long UI_TIMEOUT_MS = 30000;
   static constexpr unsigned long UNLOCK_DISPLAY_MS = 3000;
+  // Loop passes faster than this are not traced; most take well under it.
+  static constexpr uint32_t LOOP_TRACE_MIN_US = 5000;
 
   void setupOTA();
   void setupRelays();
@@ -64,6 +70,7 @@ class App {
   void handleUIKey(char key);
   void resetToMonitoring();
   void buildUserSlotMap();
+  void pollSerialCommand();
 
   static constexpr uint8_t MAX_SLOTS = 10;
   uint8_t _userSlotCount = 0;
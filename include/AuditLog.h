@@ -0,0 +1,86 @@
+#pragma once
+
+#include "AccessController.h"
+#include "SegmentRing.h"
+
+#include <Arduino.h>
+
+#include <array>
+
+struct AuditRecord {
+  uint32_t epoch = 0;
+  uint8_t type = 0;
+  uint8_t userRef = 0;
+  uint8_t failedCount = 0;
+  uint8_t reserved = 0;
+};
+static_assert(sizeof(AuditRecord) == 8, "AuditRecord is stored verbatim");
+
+struct AuditQuery {
+  uint32_t since = 0;
+  uint32_t until = UINT32_MAX;
+  int16_t userRef = -1;
+  uint32_t cursor = 0;
+  uint32_t endSeq = 0;
+};
+
+struct AuditEntry {
+  uint32_t seq = 0;
+  AuditRecord record;
+};
+
+// Append-only access log in a SegmentRing under /audit. A per-block epoch
+// range and user bitmask kept in RAM lets queries skip whole blocks without
+// reading them. User ids live in a small table of refs that are released
+// once the last block naming them is overwritten.
+class AuditLog {
+ public:
+  static constexpr size_t SEGMENT_RECORDS = 1024;
+  static constexpr size_t MAX_SEGMENTS = 6;
+  static constexpr size_t BLOCK_RECORDS = 128;
+  static constexpr size_t MAX_USERS = 32;
+  static constexpr size_t USER_ID_CAPACITY = sizeof(AccessEvent::userId);
+
+  bool begin();
+  void append(const AccessEvent& event);
+
+  [[nodiscard]] AuditQuery makeQuery(uint32_t since, uint32_t until,
+                                     const char* userId, uint32_t cursor);
+  size_t read(AuditQuery& query, AuditEntry* out, size_t max);
+  [[nodiscard]] const char* userName(uint8_t ref) const;
+  [[nodiscard]] uint8_t userCount() const { return _userCount; }
+
+  [[nodiscard]] uint32_t firstSeq() const { return _ring.firstSeq(); }
+  [[nodiscard]] uint32_t nextSeq() const { return _ring.nextSeq(); }
+  [[nodiscard]] uint32_t writeErrors() const {
+    return _ring.writeErrors() + _userWriteErrors;
+  }
+
+ private:
+  static constexpr size_t BLOCKS_PER_SEGMENT = SEGMENT_RECORDS / BLOCK_RECORDS;
+  static constexpr size_t BLOCK_COUNT = BLOCKS_PER_SEGMENT * MAX_SEGMENTS;
+  static_assert(SEGMENT_RECORDS % BLOCK_RECORDS == 0,
+                "segments must hold whole blocks");
+
+  struct BlockIndex {
+    uint32_t minEpoch = UINT32_MAX;
+    uint32_t maxEpoch = 0;
+    uint32_t userMask = 0;
+  };
+
+  SegmentRing<AuditRecord, SEGMENT_RECORDS, MAX_SEGMENTS> _ring{"/audit"};
+  uint32_t _userWriteErrors = 0;
+  std::array<BlockIndex, BLOCK_COUNT> _blocks{};
+  std::array<std::array<char, USER_ID_CAPACITY>, MAX_USERS> _users{};
+  uint8_t _userCount = 0;
+
+  void loadUsers();
+  uint8_t userRef(const char* userId);
+  bool storeUser(uint8_t ref);
+  void releaseUnusedUsers();
+  int16_t findUser(const char* userId) const;
+  void noteRecord(uint32_t seq, const AuditRecord& record);
+  void resetSegmentBlocks(uint32_t segment);
+  [[nodiscard]] bool blockMatches(uint32_t block,
+                                  const AuditQuery& query) const;
+};
@@ -5,6 +5,9 @@
 #include <LittleFS.h>
 
 #include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
 
 constexpr size_t MAX_WIFI_NETWORKS = 8;
 constexpr size_t MAX_USERS = 10;
@@ -25,16 +28,19 @@ struct UserCredential {
 struct AppConfig {
   std::array<WiFiCredential, MAX_WIFI_NETWORKS> wifiNetworks;
   std::array<UserCredential, MAX_USERS> users;
-  uint32_t sensorReadIntervalSec = 5;
-  uint32_t cloudSendIntervalSec = 60;
-  float warnThresholdC = 27.0f;
-  float stage2ThresholdC = 28.0f;
-  bool fan1BaselineOn = true;
-  uint8_t maxFailedAttempts = 3;
-  uint32_t keypadLockoutSec = 120;
-  uint32_t solenoidUnlockSec = 10;
+  uint32_t sensorReadIntervalSec;
+  uint32_t cloudSendIntervalSec;
+  float warnThresholdC;
+  float stage2ThresholdC;
+  bool fan1BaselineOn;
+  uint8_t maxFailedAttempts;
+  uint32_t keypadLockoutSec;
+  uint32_t solenoidUnlockSec;
   String googleScriptUrl;
   String deviceId;
+  String connectivityProbeUrl;
+  // Bumped on every persisted change; served as the config ETag.
+  uint32_t version = 0;
 
   AppConfig();
 };
@@ -48,39 +54,75 @@ constexpr const char* ENABLED = "e";
 constexpr const char* USER_ID = "id";
 constexpr const char* DISPLAY_NAME = "n";
 constexpr const char* PIN_HASH = "ph";
-constexpr const char* SENSOR_INTERVAL = "sensor_interval";
-constexpr const char* CLOUD_INTERVAL = "cloud_interval";
-constexpr const char* WARN_THRESHOLD = "th_warn";
-constexpr const char* STAGE2_THRESHOLD = "th_stage2";
-constexpr const char* FAN1_BASELINE = "fan1_baseline";
-constexpr const char* MAX_FAILED = "max_failed";
-constexpr const char* KEYPAD_LOCKOUT = "lockout_secs";
-constexpr const char* SOLENOID_UNLOCK = "unlock_secs";
-constexpr const char* GOOGLE_SCRIPT_URL = "gscript_url";
-constexpr const char* DEVICE_ID = "device_id";
+constexpr const char* VERSION = "ver";
 }  // namespace ConfigKeys
 
+// Pins one published config version for as long as it is alive. Keep it
+// scoped to a function: the next writer waits for readers of the version it
+// is about to reuse, and must not be called while the same task holds one.
+class ConfigSnapshot {
+ public:
+  ConfigSnapshot(const ConfigSnapshot&) = delete;
+  ConfigSnapshot& operator=(const ConfigSnapshot&) = delete;
+  ~ConfigSnapshot() { _readers->fetch_sub(1); }
+
+  const AppConfig* operator->() const { return _config; }
+  const AppConfig& operator*() const { return *_config; }
+
+ private:
+  friend class ConfigManager;
+  ConfigSnapshot(std::atomic<uint16_t>* readers, const AppConfig* config)
+      : _readers(readers), _config(config) {}
+
+  std::atomic<uint16_t>* _readers;
+  const AppConfig* _config;
+};
+
+// Config is double-buffered: readers pin the active copy without locking,
+// writers edit the spare copy and publish it with one atomic index swap.
 class ConfigManager {
  public:
+  using Mutator = std::function<bool(AppConfig&)>;
+  // Checked against the live config inside the write; false abandons the
+  // change the same way a mutator returning false does.
+  using Precondition = std::function<bool(const AppConfig&)>;
+
   explicit ConfigManager(const char* filename = "/config.json");
 
   [[nodiscard]] bool begin();
   [[nodiscard]] bool load();
-  bool save();
+
+  [[nodiscard]] ConfigSnapshot read() const;
+  // Runs `mutate` on a copy of the live config. Returning true publishes and
+  // saves the copy; returning false discards it.
+  bool update(const Mutator& mutate);
 
   bool addWiFi(const String& ssid, const String& password);
   bool removeWiFi(const String& ssid);
   [[nodiscard]] size_t getWiFiCount() const;
   void clearAllWiFi();
 
-  bool upsertUser(const UserCredential& user);
-  bool removeUser(const String& userId);
+  bool upsertUser(const UserCredential& user,
+                  const Precondition& precondition = nullptr);
+  // Merges `count` users in one published update and one flash write. A user
+  // with an empty pinHash keeps its stored PIN and must already exist. If any
+  // user cannot be placed nothing is applied and `failed` is its index.
+  bool upsertUsers(const UserCredential* users, size_t count, size_t& created,
+                   size_t& failed, const Precondition& precondition = nullptr);
+  bool removeUser(const String& userId,
+                  const Precondition& precondition = nullptr);
   [[nodiscard]] size_t getUserCount() const;
-  [[nodiscard]] const UserCredential* findUser(const String& userId) const;
-
-  AppConfig data;
+  [[nodiscard]] bool findUser(const String& userId,
+                              UserCredential& out) const;
 
  private:
   const char* _filename;
+  std::array<AppConfig, 2> _slots;
+  mutable std::array<std::atomic<uint16_t>, 2> _readers{};
+  std::atomic<uint8_t> _active{0};
+  std::mutex _writeLock;
+
+  bool commit(const Mutator& mutate, bool persist);
+  bool save(const AppConfig& config);
   bool resetToDefaultsAndSave();
 };
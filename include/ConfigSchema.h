@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Config.h"
+
+#include <ArduinoJson.h>
+
+#include <tuple>
+
+enum class ConfigGroup : uint8_t { Internal, Thermal, Security };
+
+template <typename T>
+struct ConfigField {
+  const char* key;
+  const char* api;
+  const char* label;
+  ConfigGroup group;
+  T AppConfig::*member;
+  T min;
+  T max;
+  T fallback;
+};
+
+struct ConfigTextField {
+  const char* key;
+  const char* api;
+  const char* label;
+  ConfigGroup group;
+  String AppConfig::*member;
+  uint16_t maxLen;
+  const char* fallback;
+  bool (*accept)(const char* value);
+  bool required;
+};
+
+// Every scalar setting is declared once here. Load, save, range checks, the
+// config REST handlers and the setup page form are all generated from it;
+// adding a setting means adding one row. WiFi networks and users are lists
+// and keep their own code in ConfigManager.
+namespace ConfigSchema {
+
+constexpr const char* DEFAULT_DEVICE_ID = "esp32-smart-server-01";
+constexpr const char* DEFAULT_PROBE_URL =
+    "http://connectivitycheck.gstatic.com/generate_204";
+constexpr const char* DEFAULT_GSCRIPT_URL =
+    "https://script.google.com/macros/s/AKfycbxVuisohtU0X2y6SBJhpR7stwr54dERGWv8wgq9KsjWhxZb-eH541N9pq33luIBhrWH4g/exec";
+
+bool acceptHttpUrl(const char* value);
+
+inline constexpr auto FIELDS = std::make_tuple(
+    ConfigField<float>{"th_warn", "warnThreshold", "Ambang Peringatan (C)",
+                       ConfigGroup::Thermal, &AppConfig::warnThresholdC,
+                       -40.0f, 125.0f, 27.0f},
+    ConfigField<float>{"th_stage2", "stage2Threshold", "Ambang Alarm (C)",
+                       ConfigGroup::Thermal, &AppConfig::stage2ThresholdC,
+                       -40.0f, 125.0f, 28.0f},
+    ConfigField<bool>{"fan1_baseline", "fan1BaselineOn", "Kipas 1 Dasar",
+                      ConfigGroup::Thermal, &AppConfig::fan1BaselineOn, false,
+                      true, true},
+    ConfigField<uint32_t>{"sensor_interval", "sensorReadIntervalSec",
+                          "Interval Sensor (d)", ConfigGroup::Thermal,
+                          &AppConfig::sensorReadIntervalSec, 1, 3600, 5},
+    ConfigField<uint32_t>{"cloud_interval", "cloudSendIntervalSec",
+                          "Interval Cloud (d)", ConfigGroup::Thermal,
+                          &AppConfig::cloudSendIntervalSec, 10, 86400, 60},
+    ConfigField<uint8_t>{"max_failed", "maxFail", "Maks Percobaan Gagal",
+                         ConfigGroup::Security, &AppConfig::maxFailedAttempts,
+                         1, 20, 3},
+    ConfigField<uint32_t>{"lockout_secs", "lockoutSecs", "Penguncian (d)",
+                          ConfigGroup::Security, &AppConfig::keypadLockoutSec,
+                          10, 86400, 120},
+    ConfigField<uint32_t>{"unlock_secs", "unlockSecs", "Buka Solenoid (d)",
+                          ConfigGroup::Security,
+                          &AppConfig::solenoidUnlockSec, 1, 300, 10},
+    ConfigTextField{"device_id", "deviceId", "ID Perangkat",
+                    ConfigGroup::Security, &AppConfig::deviceId, 32,
+                    DEFAULT_DEVICE_ID, nullptr, true},
+    ConfigTextField{"probe_url", "probeUrl", "URL Cek Internet (204)",
+                    ConfigGroup::Security, &AppConfig::connectivityProbeUrl,
+                    127, DEFAULT_PROBE_URL, acceptHttpUrl, false},
+    ConfigTextField{"gscript_url", nullptr, nullptr, ConfigGroup::Internal,
+                    &AppConfig::googleScriptUrl, 255, DEFAULT_GSCRIPT_URL,
+                    acceptHttpUrl, true});
+
+void applyDefaults(AppConfig& config);
+[[nodiscard]] bool validate(JsonVariantConst doc);
+void load(JsonVariantConst doc, AppConfig& config);
+void save(const AppConfig& config, JsonVariant doc);
+
+void toApi(const AppConfig& config, ConfigGroup group, JsonObject out);
+// Applies the fields of `group` present in `in`. Stops at the first field
+// with a wrong type or an out-of-range value and returns its API name.
+[[nodiscard]] const char* fromApi(JsonObjectConst in, ConfigGroup group,
+                                  AppConfig& config);
+void describe(JsonObject out);
+
+}  // namespace ConfigSchema
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <functional>
+
+struct ProbeOutcome {
+  uint32_t attempt = 0;
+  bool online = false;
+  int httpCode = 0;
+  uint32_t durationMs = 0;
+};
+
+// Runs the captive-portal check on its own task. start() and poll() are
+// called from the main loop; the callback fires from poll(), never from the
+// probe task. The caller's attempt id comes back in the outcome so a result
+// that outlived its connection attempt can be told apart.
+class ConnectivityProbe {
+ public:
+  using Callback = std::function<void(const ProbeOutcome&)>;
+  static constexpr size_t URL_CAPACITY = 128;
+
+  void begin(Callback onResult);
+  bool start(const String& url, uint32_t timeoutMs, uint32_t attempt);
+  void poll();
+
+  [[nodiscard]] bool busy() const { return _phase != Phase::Idle; }
+  [[nodiscard]] const ProbeOutcome& last() const { return _last; }
+
+ private:
+  enum class Phase : uint8_t { Idle, Running, Done };
+
+  static constexpr uint32_t TASK_STACK = 6144;
+
+  TaskHandle_t _task = nullptr;
+  Callback _onResult;
+  std::atomic<Phase> _phase{Phase::Idle};
+
+  char _url[URL_CAPACITY] = {};
+  uint32_t _timeoutMs = 5000;
+  uint32_t _attempt = 0;
+  int _httpCode = 0;
+  uint32_t _durationMs = 0;
+  ProbeOutcome _last;
+
+  static void taskEntry(void* arg);
+  void run();
+};
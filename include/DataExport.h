@@ -0,0 +1,81 @@
+#pragma once
+
+#include "AuditLog.h"
+#include "SensorHistory.h"
+
+#include <Arduino.h>
+
+#include <array>
+
+enum class ExportKind : uint8_t { Telemetry, Access };
+enum class ExportFormat : uint8_t { Csv, Binary };
+
+// Escapes `value` for a JSON string body; drops control characters.
+size_t copyJsonString(char* out, size_t cap, const char* value);
+// Quotes a CSV field only when it holds a comma or a quote.
+size_t copyCsvField(char* out, size_t cap, const char* value);
+
+// Streams a time range of sensor history or the access log, read from flash
+// one block at a time into a fixed buffer, so memory does not grow with the
+// range. The binary format is little-endian and column-major so the
+// dashboard can view each column as a typed array:
+//
+//   "SSXB", u8 version, u8 kind, u16 metaLen
+//   metaLen bytes of JSON (columns with name/type/scale, access user names),
+//     space padded to a multiple of 4
+//   blocks: u32 rows, then each column's values zero padded to 4 bytes
+//   a block of 0 rows ends the stream
+class DataExport {
+ public:
+  static constexpr uint8_t BINARY_VERSION = 1;
+  static constexpr size_t BLOCK_ROWS = 128;
+  static constexpr size_t BUFFER_SIZE = 1536;
+  static constexpr size_t MAX_COLUMNS = 5;
+
+  DataExport(ExportKind kind, ExportFormat format, uint32_t from, uint32_t to,
+             SensorHistory& history, AuditLog& audit);
+
+  // Chunked response filler; returns 0 once the export is complete.
+  size_t fill(uint8_t* buf, size_t maxLen);
+
+  [[nodiscard]] uint32_t rows() const { return _rows; }
+
+  static bool parseKind(const String& text, ExportKind& out);
+  static bool parseFormat(const String& text, ExportFormat& out);
+  [[nodiscard]] static const char* kindName(ExportKind kind);
+
+  struct Column {
+    const char* name;
+    const char* type;
+    uint8_t size;
+    int8_t scale;
+  };
+
+ private:
+  using RowValues = std::array<uint32_t, MAX_COLUMNS>;
+
+  enum class Phase : uint8_t { Header, Rows, Done };
+
+  ExportKind _kind;
+  ExportFormat _format;
+  SensorHistory& _history;
+  AuditLog& _audit;
+  SensorQuery _sensorQuery;
+  AuditQuery _auditQuery;
+  Phase _phase = Phase::Header;
+  uint32_t _rows = 0;
+
+  uint8_t _buf[BUFFER_SIZE];
+  size_t _len = 0;
+  size_t _pos = 0;
+
+  bool refill();
+  [[nodiscard]] const Column* columns(size_t& count) const;
+  size_t nextRows(RowValues* out, size_t max);
+  void writeHeader();
+  void writeBinaryHeader();
+  // Returns false once the terminating block has been written.
+  bool writeBlock();
+  bool writeCsvRows();
+  size_t formatCsvRow(const RowValues& row, char* out, size_t cap) const;
+};
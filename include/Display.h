@@ -34,9 +34,9 @@ class Display {
   void showMessage(const char* title, const char* msg, bool success);
 
   void setWifiInfo(bool connected, const String& ip);
-  void setTelemetry(float temperature, float humidity, bool valid, bool fan1On,
-                    bool fan2On, bool warning);
-  void setSecurity(const String& doorState, const String& accessMessage,
+  void setTelemetry(int16_t temperatureCenti, uint16_t humidityCenti,
+                    bool valid, bool fan1On, bool fan2On, bool warning);
+  void setSecurity(const String& doorState, const char* accessMessage,
                    bool lockoutActive, uint32_t lockoutRemainSec);
 
   [[nodiscard]] bool isReady() const { return _ready; }
@@ -50,8 +50,8 @@ class Display {
 
   bool _wifiConnected = false;
   String _ipAddress = "-";
-  float _temperature = 0.0f;
-  float _humidity = 0.0f;
+  int16_t _temperatureCenti = 0;
+  uint16_t _humidityCenti = 0;
   bool _sensorValid = false;
   bool _fan1On = false;
   bool _fan2On = false;
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+// Fixed ring of POD events. Every subscriber owns a cursor and reads at its
+// own pace; a subscriber that falls more than N events behind skips ahead and
+// has the gap added to `missed`.
+template <typename T, size_t N>
+class EventBus {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "EventBus events must be trivially copyable");
+
+ public:
+  struct Subscription {
+    uint32_t cursor = 0;
+    uint32_t missed = 0;
+  };
+
+  void publish(const T& event) {
+    portENTER_CRITICAL(&_lock);
+    _slots[_head % N] = event;
+    _head = _head + 1;
+    portEXIT_CRITICAL(&_lock);
+  }
+
+  [[nodiscard]] Subscription subscribe() {
+    portENTER_CRITICAL(&_lock);
+    Subscription sub{_head, 0};
+    portEXIT_CRITICAL(&_lock);
+    return sub;
+  }
+
+  bool poll(Subscription& sub, T& out) {
+    portENTER_CRITICAL(&_lock);
+    if (sub.cursor == _head) {
+      portEXIT_CRITICAL(&_lock);
+      return false;
+    }
+    if (_head - sub.cursor > N) {
+      sub.missed += _head - sub.cursor - N;
+      sub.cursor = _head - N;
+    }
+    out = _slots[sub.cursor % N];
+    ++sub.cursor;
+    portEXIT_CRITICAL(&_lock);
+    return true;
+  }
+
+  [[nodiscard]] uint32_t backlog(const Subscription& sub) const {
+    return _head - sub.cursor;
+  }
+  [[nodiscard]] uint32_t published() const { return _head; }
+
+ private:
+  std::array<T, N> _slots{};
+  volatile uint32_t _head = 0;
+  portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+};
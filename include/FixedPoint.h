@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Sensor readings travel as integer hundredths ("centi" units) from the
+// sensor read onwards; only the edges that show or accept a float convert.
+inline int32_t toCenti(float value) {
+  return static_cast<int32_t>(lroundf(value * 100.0f));
+}
+
+// Integer division rounding half away from zero.
+constexpr int32_t divRound(int64_t num, int64_t den) {
+  if (den == 0) return 0;
+  const int64_t half = (den < 0 ? -den : den) / 2;
+  const int64_t biased = (num < 0) != (den < 0) ? num - half : num + half;
+  return static_cast<int32_t>(biased / den);
+}
+
+// Writes the decimal digits of `value`; returns the length, or 0 when it does
+// not fit in `cap` with its NUL.
+inline size_t writeUnsigned(char* out, size_t cap, uint64_t value) {
+  char digits[20];
+  size_t n = 0;
+  do {
+    digits[n++] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  if (n + 1 > cap) return 0;
+  for (size_t i = 0; i < n; ++i) out[i] = digits[n - 1 - i];
+  out[n] = '\0';
+  return n;
+}
+
+// Writes `value` × 10^-decimals with exactly `decimals` places, e.g.
+// (-1234, 2) -> "-12.34", (5, 3) -> "0.005". Same contract as
+// writeUnsigned.
+inline size_t writeFixed(char* out, size_t cap, int32_t value,
+                         uint8_t decimals) {
+  const bool negative = value < 0;
+  uint32_t magnitude = negative ? 0U - static_cast<uint32_t>(value)
+                                : static_cast<uint32_t>(value);
+  uint32_t scale = 1;
+  for (uint8_t i = 0; i < decimals; ++i) scale *= 10;
+
+  size_t len = 0;
+  if (negative) {
+    if (cap < 2) return 0;
+    out[len++] = '-';
+  }
+  const size_t whole = writeUnsigned(out + len, cap - len, magnitude / scale);
+  if (whole == 0) return 0;
+  len += whole;
+  if (decimals == 0) return len;
+  if (len + 1 + decimals + 1 > cap) return 0;
+  out[len++] = '.';
+  magnitude %= scale;
+  for (uint8_t i = decimals; i > 0; --i) {
+    out[len + i - 1] = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  }
+  len += decimals;
+  out[len] = '\0';
+  return len;
+}
@@ -1,31 +1,48 @@
 #pragma once
 
+#include "RequestBuilder.h"
+
 #include <Arduino.h>
 
+// Timestamps are epochs formatted when the request is built; epoch 0 means
+// the clock was not set and sampledAtMs is sent instead. Sensor values are
+// in hundredths.
 struct TelemetryLogPayload {
-  String timestamp;
-  String deviceId;
-  float temperatureC = 0.0f;
-  float humidityPct = 0.0f;
+  uint32_t epoch = 0;
+  char deviceId[33] = {};
   bool fan1On = false;
   bool fan2On = false;
   bool alarmState = false;
-  String doorState;
+  const char* doorState = "";
   int32_t wifiRssi = 0;
-  float warnThreshold = 0.0f;
-  float stage2Threshold = 0.0f;
+  int16_t warnThresholdCenti = 0;
+  int16_t stage2ThresholdCenti = 0;
+  unsigned long sampledAtMs = 0;
+
+  // Sums over sampleCount samples; a single sample is its own sum.
+  uint16_t sampleCount = 1;
+  int32_t temperatureCentiSum = 0;
+  uint32_t humidityCentiSum = 0;
+  uint32_t periodEndEpoch = 0;
+  int16_t temperatureMinCenti = 0;
+  int16_t temperatureMaxCenti = 0;
+  uint16_t humidityMinCenti = 0;
+  uint16_t humidityMaxCenti = 0;
+  uint16_t fan1OnCount = 0;
+  uint16_t fan2OnCount = 0;
 };
 
 struct AccessLogPayload {
-  String timestamp;
-  String deviceId;
-  String userId;
-  String displayName;
-  String result;
-  String reason;
+  uint32_t epoch = 0;
+  char deviceId[33] = {};
+  char userId[24] = {};
+  char displayName[32] = {};
+  const char* result = "";
+  const char* reason = "";
   uint8_t failedCount = 0;
   uint32_t lockoutUntil = 0;
-  String doorState;
+  const char* doorState = "";
+  unsigned long sampledAtMs = 0;
 };
 
 class GoogleSheetsClient {
@@ -33,6 +50,7 @@ class GoogleSheetsClient {
   void begin(const String& scriptUrl);
 
   bool sendTelemetry(const TelemetryLogPayload& payload);
+  bool sendTelemetryAggregate(const TelemetryLogPayload& payload);
   bool sendAccess(const AccessLogPayload& payload);
 
   bool isConfigured() const { return _configured; }
@@ -40,10 +58,14 @@ class GoogleSheetsClient {
   const String& getLastError() const { return _lastError; }
 
  private:
+  static constexpr size_t URL_CAPACITY = 768;
+  using UrlBuilder = RequestBuilder<URL_CAPACITY>;
+
   String _scriptUrl;
   bool _configured = false;
+  TimestampCache _timestamps;
   int _lastHttpCode = 0;
   String _lastError;
 
-  bool sendGetRequest(const String& url);
+  bool sendGetRequest(const UrlBuilder& url);
 };
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <deque>
+#include <memory>
+#include <vector>
+
+enum class HeapTag : uint8_t {
+  Config,
+  Access,
+  Network,
+  WiFi,
+  Display,
+  Sensors,
+  HTTP,
+  Count
+};
+
+enum class HeapQueue : uint8_t {
+  UploadUrgent,
+  UploadAccess,
+  UploadTelemetry,
+  AccessEvents,
+  WiFiScan,
+  Count
+};
+
+struct HeapTagStats {
+  uint32_t liveBytes = 0;
+  uint32_t peakBytes = 0;
+  uint32_t allocCount = 0;
+};
+
+namespace HeapTracker {
+
+constexpr size_t TAG_COUNT = static_cast<size_t>(HeapTag::Count);
+constexpr size_t QUEUE_COUNT = static_cast<size_t>(HeapQueue::Count);
+
+void onAlloc(HeapTag tag, size_t bytes);
+void onFree(HeapTag tag, size_t bytes);
+// For memory only seen as a free-heap delta, which other tasks' allocations
+// also move: raises the tag's peak without counting anything as live.
+void notePeak(HeapTag tag, size_t bytes);
+void noteQueueDepth(HeapQueue queue, size_t depth);
+
+[[nodiscard]] HeapTagStats stats(HeapTag tag);
+[[nodiscard]] uint32_t queueHighWater(HeapQueue queue);
+const char* tagName(HeapTag tag);
+const char* queueName(HeapQueue queue);
+
+ArduinoJson::Allocator* jsonAllocator(HeapTag tag);
+void printReport(Print& out);
+
+// Credits whatever a setup step leaves allocated to a tag, for memory owned
+// by libraries we cannot hand an allocator to.
+class Scope {
+ public:
+  explicit Scope(HeapTag tag) : _tag(tag), _freeBefore(ESP.getFreeHeap()) {}
+  ~Scope();
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  HeapTag _tag;
+  uint32_t _freeBefore;
+};
+
+}  // namespace HeapTracker
+
+template <typename T, HeapTag Tag>
+struct TrackedAllocator {
+  using value_type = T;
+
+  TrackedAllocator() = default;
+  template <typename U>
+  TrackedAllocator(const TrackedAllocator<U, Tag>&) {}
+
+  T* allocate(size_t n) {
+    HeapTracker::onAlloc(Tag, n * sizeof(T));
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* p, size_t n) {
+    HeapTracker::onFree(Tag, n * sizeof(T));
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  template <typename U>
+  struct rebind {
+    using other = TrackedAllocator<U, Tag>;
+  };
+
+  template <typename U>
+  bool operator==(const TrackedAllocator<U, Tag>&) const {
+    return true;
+  }
+};
+
+template <typename T, HeapTag Tag>
+using TrackedDeque = std::deque<T, TrackedAllocator<T, Tag>>;
+
+template <typename T, HeapTag Tag>
+using TrackedVector = std::vector<T, TrackedAllocator<T, Tag>>;
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Arduino.h>
+#include <array>
+
+template <size_t N>
+class Histogram {
+ public:
+  explicit constexpr Histogram(const std::array<uint32_t, N>& bounds)
+      : _bounds(bounds) {}
+
+  void observe(uint32_t value) {
+    size_t i = 0;
+    while (i < N && value > _bounds[i]) ++i;
+    ++_buckets[i];
+    _sum += value;
+    ++_count;
+  }
+
+  [[nodiscard]] size_t bucketCount() const { return N; }
+  [[nodiscard]] uint32_t bound(size_t i) const { return _bounds[i]; }
+  [[nodiscard]] uint32_t bucket(size_t i) const { return _buckets[i]; }
+  [[nodiscard]] uint64_t sum() const { return _sum; }
+  [[nodiscard]] uint32_t count() const { return _count; }
+
+ private:
+  std::array<uint32_t, N> _bounds;
+  std::array<uint32_t, N + 1> _buckets{};
+  uint64_t _sum = 0;
+  uint32_t _count = 0;
+};
+
+class MetricsWriter {
+ public:
+  MetricsWriter(char* buf, size_t cap);
+
+  void family(const char* name, const char* type, const char* help);
+  void sample(const char* name, const char* labels, int64_t value);
+
+  template <size_t N>
+  void histogram(const char* name, const char* help, const Histogram<N>& h) {
+    family(name, "histogram", help);
+    uint32_t cumulative = 0;
+    for (size_t i = 0; i < N; ++i) {
+      cumulative += h.bucket(i);
+      append("%s_bucket{le=\"%lu\"} %lu\n", name,
+             static_cast<unsigned long>(h.bound(i)),
+             static_cast<unsigned long>(cumulative));
+    }
+    append("%s_bucket{le=\"+Inf\"} %lu\n", name,
+           static_cast<unsigned long>(h.count()));
+    append("%s_sum %llu\n", name, static_cast<unsigned long long>(h.sum()));
+    append("%s_count %lu\n", name, static_cast<unsigned long>(h.count()));
+  }
+
+  [[nodiscard]] size_t length() const { return _len; }
+  [[nodiscard]] bool truncated() const { return _truncated; }
+
+ private:
+  char* _buf;
+  size_t _cap;
+  size_t _len = 0;
+  bool _truncated = false;
+
+  void append(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+namespace Metrics {
+
+enum class Route : uint8_t {
+  Root,
+  Setup,
+  State,
+  Batch,
+  ConfigSchema,
+  ThermalGet,
+  ThermalSet,
+  SecurityGet,
+  SecuritySet,
+  UsersGet,
+  UsersUpsert,
+  UsersDelete,
+  UsersImport,
+  UsersExport,
+  SendNow,
+  AccessLog,
+  Export,
+  WiFiScan,
+  WiFiConnect,
+  WiFiJob,
+  Metrics,
+  Trace,
+  Profile,
+  Heap,
+  NotFound,
+  Count
+};
+
+void observeLoop(uint32_t durationUs);
+void observeUpload(uint32_t durationMs, int httpCode, int32_t rssi);
+void observeRoam();
+void observeUnlockLatency(uint32_t durationUs);
+void observeRoute(Route route, uint32_t durationUs);
+void observeDispatch(uint32_t durationNs);
+void observeWiFiConnect(uint32_t durationMs, bool fastPath);
+const char* routeName(Route route);
+
+void writeCollected(MetricsWriter& out);
+
+}  // namespace Metrics
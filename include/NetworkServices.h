@@ -1,16 +1,33 @@
 #pragma once
 
 #include "AccessController.h"
+#include "AuditLog.h"
 #include "Config.h"
+#include "ConfigSchema.h"
 #include "GoogleSheetsClient.h"
+#include "Metrics.h"
+#include "RouteTrie.h"
+#include "SeqLock.h"
+#include "SensorHistory.h"
 #include "Sensors.h"
+#include "UploadScheduler.h"
+#include "UserImport.h"
 #include "WiFiHandler.h"
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <ESPAsyncWebServer.h>
 
-#include <deque>
+#include <atomic>
+#include <memory>
+
+struct LiveState {
+  SensorData data{};
+  bool fan1On = false;
+  bool fan2On = false;
+  bool warning = false;
+  bool solenoidOn = false;
+};
 
 class NetworkServices {
  public:
@@ -20,10 +37,10 @@ class NetworkServices {
              AccessController* access);
   void update(const SensorData& data, bool fan1On, bool fan2On, bool warning,
               bool solenoidOn);
-  void logAccessEvent(const AccessEvent& event);
 
  private:
   AsyncWebServer _server;
+  AsyncEventSource _wifiEvents;
   ConfigManager* _config = nullptr;
   WiFiManager* _wifi = nullptr;
   SensorManager* _sensors = nullptr;
@@ -31,45 +48,90 @@ class NetworkServices {
 
   GoogleSheetsClient _googleSheets;
 
-  SensorData _cachedData{};
-  bool _cachedFan1On = false;
-  bool _cachedFan2On = false;
-  bool _cachedWarning = false;
-  bool _cachedSolenoidOn = false;
+  SeqLock<LiveState> _live;
 
   unsigned long _lastTelemetryEnqueueMs = 0;
   unsigned long _lastSendEpoch = 0;
 
-  std::deque<TelemetryLogPayload> _telemetryQueue;
-  std::deque<AccessLogPayload> _accessQueue;
+  UploadScheduler _uploads;
   unsigned long _nextAttemptMs = 0;
   uint8_t _retryCount = 0;
 
+  unsigned long _nextUrgentAttemptMs = 0;
+  uint8_t _urgentRetryCount = 0;
+  bool _stage2Active = false;
+  unsigned long _lastUrgentLatencyMs = 0;
+  unsigned long _maxUrgentLatencyMs = 0;
+
+  uint32_t _publishedJobRevision = 0;
+
+  AccessController::EventBusType::Subscription _uploadEvents;
+  AccessController::EventBusType::Subscription _metricsEvents;
+  AccessController::EventBusType::Subscription _auditEvents;
+  AuditLog _auditLog;
+  SensorHistory _history;
+  unsigned long _lastHistoryMs = 0;
+  // Counted on the loop as events drain; /metrics only reads the totals.
+  std::array<std::atomic<uint32_t>, 4> _accessEventCounts{};
+
+  // One bulk import at a time, owned by the request whose body it parses.
+  std::unique_ptr<UserImport> _import;
+  AsyncWebServerRequest* _importOwner = nullptr;
+  unsigned long _importStartedUs = 0;
+
+  class RouteDispatcher;
+
+  void setupAdmission();
   void setupRoutes();
-  void setupWiFiRoutes();
+  void dispatch(Metrics::Route route, AsyncWebServerRequest* request,
+                const RouteParams& params, JsonVariant& json);
+  void streamBody(Metrics::Route route, AsyncWebServerRequest* request,
+                  uint8_t* data, size_t len, size_t index, size_t total);
 
   void handleRoot(AsyncWebServerRequest* request);
   void handleGetState(AsyncWebServerRequest* request);
-  void handleGetThermalConfig(AsyncWebServerRequest* request);
-  void handleSetThermalConfig(AsyncWebServerRequest* request, JsonVariant& json);
-  void handleGetSecurityConfig(AsyncWebServerRequest* request);
-  void handleSetSecurityConfig(AsyncWebServerRequest* request,
-                               JsonVariant& json);
+  void handleBatch(AsyncWebServerRequest* request);
+  void handleMetrics(AsyncWebServerRequest* request);
+  void handleHeap(AsyncWebServerRequest* request);
+  void handleTrace(AsyncWebServerRequest* request);
+  void handleProfile(AsyncWebServerRequest* request);
+  void handleConfigSchema(AsyncWebServerRequest* request);
+  void handleGetConfig(AsyncWebServerRequest* request, ConfigGroup group);
+  void handleSetConfig(AsyncWebServerRequest* request, JsonVariant& json,
+                       ConfigGroup group);
   void handleGetUsers(AsyncWebServerRequest* request);
   void handleUpsertUser(AsyncWebServerRequest* request, JsonVariant& json);
-  void handleDeleteUser(AsyncWebServerRequest* request);
+  void handleDeleteUser(AsyncWebServerRequest* request,
+                        const String& userId);
+  void handleImportBody(AsyncWebServerRequest* request, uint8_t* data,
+                        size_t len, size_t index, size_t total);
+  void handleImportUsers(AsyncWebServerRequest* request);
+  void handleExportUsers(AsyncWebServerRequest* request);
   void handleSendNow(AsyncWebServerRequest* request);
+  void handleAccessLog(AsyncWebServerRequest* request);
+  void handleExport(AsyncWebServerRequest* request);
   void handleWiFiScan(AsyncWebServerRequest* request);
   void handleWiFiConnect(AsyncWebServerRequest* request, JsonVariant& json);
+  void handleWiFiJob(AsyncWebServerRequest* request, uint32_t jobId);
+  void publishWiFiJob();
 
-  void enqueueTelemetry();
-  String doorState() const;
-  String makeTimestampIso8601() const;
+  void fillState(JsonObject doc);
+  void fillUsers(const AppConfig& config, JsonObject doc);
+  void fillWiFiScan(JsonObject doc);
+
+  void drainAccessEvents();
+  void recordHistory(const SensorData& data, bool fan1On, bool fan2On,
+                     bool warning);
+  void logAccessEvent(const AccessEvent& event);
+  void enqueueTelemetry(bool urgent = false);
+  const char* doorState() const;
 
-  void enqueueTelemetryPayload(const TelemetryLogPayload& payload);
-  void enqueueAccessPayload(const AccessLogPayload& payload);
+  void setupUploadPolicies();
+  void enqueueUpload(UploadClass cls, UploadItem item);
   void flushQueueTick();
   bool flushNow(uint16_t maxItems);
   bool sendOne();
+  bool hasUrgent() const;
   void backoff();
+  void urgentBackoff();
 };
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 0
+#endif
+
+#ifndef PROFILER_TABLE_SIZE
+#define PROFILER_TABLE_SIZE 1024
+#endif
+
+namespace Profiler {
+
+void begin();
+void reset();
+[[nodiscard]] uint32_t totalSamples();
+
+class TextExporter {
+ public:
+  TextExporter();
+
+  size_t fill(uint8_t* buf, size_t maxLen);
+
+ private:
+  enum class Stage : uint8_t { Header, Tasks, Samples, Done };
+
+  Stage _stage = Stage::Header;
+  size_t _cursor = 0;
+  char _line[96];
+  size_t _lineLen = 0;
+  size_t _lineOffset = 0;
+
+  bool nextLine();
+};
+
+}  // namespace Profiler
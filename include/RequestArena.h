@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#ifndef REQUEST_ARENA_SIZE
+#define REQUEST_ARENA_SIZE 4096
+#endif
+
+#ifndef REQUEST_ARENA_COUNT
+#define REQUEST_ARENA_COUNT 3
+#endif
+
+struct RequestArenaStats {
+  uint32_t acquired = 0;
+  uint32_t exhausted = 0;
+  uint32_t heapSpills = 0;
+  size_t highWaterBytes = 0;
+  uint8_t inUse = 0;
+};
+
+class RequestArena : public ArduinoJson::Allocator {
+ public:
+  static RequestArena* acquire();
+  static void release(RequestArena* arena);
+  static RequestArenaStats stats();
+
+  void* allocate(size_t size) override;
+  void deallocate(void* ptr) override;
+  void* reallocate(void* ptr, size_t newSize) override;
+
+  char* allocText(size_t size);
+  [[nodiscard]] bool pooled() const { return _capacity > 0; }
+
+ private:
+  struct Header {
+    uint32_t size;
+    uint32_t reserved;
+  };
+
+  uint8_t* _buf = nullptr;
+  size_t _capacity = 0;
+  size_t _used = 0;
+  size_t _lastOffset = SIZE_MAX;
+  bool _inUse = false;
+
+  [[nodiscard]] bool owns(const void* ptr) const;
+  void reset();
+  static size_t align(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+  }
+};
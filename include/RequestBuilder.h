@@ -0,0 +1,167 @@
+#pragma once
+
+#include "FixedPoint.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <time.h>
+
+// Local-time ISO 8601 stamps ("2024-05-01T13:45:07"). localtime_r and
+// strftime run once per hour; stamps inside the cached hour only patch the
+// minutes and seconds.
+class TimestampCache {
+ public:
+  static constexpr size_t LENGTH = 19;
+
+  // Writes LENGTH characters and a NUL.
+  void format(uint32_t epoch, char (&out)[LENGTH + 1]) {
+    if (!_valid || epoch < _hourStart || epoch - _hourStart >= 3600) {
+      refresh(epoch);
+    }
+    const uint32_t offset = epoch - _hourStart;
+    memcpy(out, _prefix, PREFIX_LENGTH);
+    out[14] = static_cast<char>('0' + offset / 600);
+    out[15] = static_cast<char>('0' + offset / 60 % 10);
+    out[16] = ':';
+    out[17] = static_cast<char>('0' + offset % 60 / 10);
+    out[18] = static_cast<char>('0' + offset % 10);
+    out[LENGTH] = '\0';
+  }
+
+  [[nodiscard]] uint32_t misses() const { return _misses; }
+
+ private:
+  static constexpr size_t PREFIX_LENGTH = 14;  // "YYYY-MM-DDTHH:"
+
+  char _prefix[PREFIX_LENGTH + 1] = {};
+  uint32_t _hourStart = 0;
+  uint32_t _misses = 0;
+  bool _valid = false;
+
+  void refresh(uint32_t epoch) {
+    const time_t now = static_cast<time_t>(epoch);
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo);
+    strftime(_prefix, sizeof(_prefix), "%Y-%m-%dT%H:", &timeinfo);
+    _hourStart = epoch - static_cast<uint32_t>(timeinfo.tm_min * 60 +
+                                               timeinfo.tm_sec);
+    _valid = true;
+    ++_misses;
+  }
+};
+
+// Builds a GET URL in a fixed buffer without touching the heap: values are
+// percent-encoded straight into place and numbers are formatted with integer
+// math. Running out of room is sticky; check ok() before using the URL.
+template <size_t Capacity>
+class RequestBuilder {
+ public:
+  explicit RequestBuilder(std::string_view base) {
+    terminate();
+    append(base);
+    _separator = base.find('?') == std::string_view::npos ? '?' : '&';
+  }
+
+  RequestBuilder& text(const char* key, std::string_view value) {
+    if (!beginParam(key)) return *this;
+    for (const char c : value) {
+      const auto byte = static_cast<uint8_t>(c);
+      if (isUnreserved(byte)) {
+        put(c);
+      } else if (room(3)) {
+        static constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+        _buf[_len++] = '%';
+        _buf[_len++] = HEX_DIGITS[byte >> 4];
+        _buf[_len++] = HEX_DIGITS[byte & 0x0F];
+      }
+    }
+    terminate();
+    return *this;
+  }
+
+  RequestBuilder& boolean(const char* key, bool value) {
+    return text(key, value ? "true" : "false");
+  }
+
+  RequestBuilder& integer(const char* key, int64_t value) {
+    if (!beginParam(key)) return *this;
+    if (value < 0) put('-');
+    const uint64_t magnitude =
+        value < 0 ? 0ULL - static_cast<uint64_t>(value)
+                  : static_cast<uint64_t>(value);
+    advance(writeUnsigned(_buf + _len, Capacity - _len, magnitude));
+    return *this;
+  }
+
+  // `value` is in units of 10^-decimals: fixed("t", 2457, 2) -> "t=24.57".
+  RequestBuilder& fixed(const char* key, int32_t value, uint8_t decimals) {
+    if (!beginParam(key)) return *this;
+    advance(writeFixed(_buf + _len, Capacity - _len, value, decimals));
+    return *this;
+  }
+
+  // Epoch 0 means the clock was never set; the uptime in ms stands in.
+  RequestBuilder& timestamp(const char* key, uint32_t epoch,
+                            uint32_t fallbackMs, TimestampCache& cache) {
+    if (epoch == 0) return integer(key, fallbackMs);
+    char stamp[TimestampCache::LENGTH + 1];
+    cache.format(epoch, stamp);
+    return text(key, std::string_view(stamp, TimestampCache::LENGTH));
+  }
+
+  [[nodiscard]] bool ok() const { return !_overflow; }
+  [[nodiscard]] const char* c_str() const { return _buf; }
+  [[nodiscard]] size_t length() const { return _len; }
+
+ private:
+  char _buf[Capacity];
+  size_t _len = 0;
+  bool _overflow = false;
+  char _separator = '?';
+
+  static constexpr bool isUnreserved(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+           (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.' ||
+           c == '~';
+  }
+
+  // Leaves space for the NUL after every write.
+  bool room(size_t n) {
+    if (!_overflow && _len + n < Capacity) return true;
+    _overflow = true;
+    return false;
+  }
+
+  void put(char c) {
+    if (room(1)) _buf[_len++] = c;
+  }
+
+  void append(std::string_view text) {
+    if (!room(text.size())) return;
+    memcpy(_buf + _len, text.data(), text.size());
+    _len += text.size();
+    terminate();
+  }
+
+  void terminate() { _buf[_len] = '\0'; }
+
+  bool beginParam(const char* key) {
+    put(_separator);
+    _separator = '&';
+    append(key);
+    put('=');
+    terminate();
+    return !_overflow;
+  }
+
+  void advance(size_t written) {
+    if (written == 0) {
+      _overflow = true;
+      terminate();
+      return;
+    }
+    _len += written;
+  }
+};
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+enum class RouteMethod : uint8_t { Get, Post, Delete, Count };
+enum class ParamType : uint8_t { None, Text, Uint };
+
+constexpr size_t MAX_ROUTE_PARAMS = 2;
+
+// Path parameters in pattern order. `{name}` captures a non-empty segment as
+// text, `{name:uint}` only matches a decimal that fits in 32 bits.
+struct RouteParams {
+  std::array<std::string_view, MAX_ROUTE_PARAMS> text{};
+  std::array<uint32_t, MAX_ROUTE_PARAMS> number{};
+  uint8_t count = 0;
+};
+
+// Segment trie over a route table, built at compile time. Each node is one
+// path segment, either literal or a typed parameter; literal children win
+// over parameters. A terminal node holds one table index per method.
+// Pure C++ so tools/ can benchmark it off-target.
+template <size_t MaxNodes>
+class RouteTrie {
+ public:
+  using Index = uint16_t;
+  static constexpr Index NONE = 0xFFFF;
+  static constexpr Index WRONG_METHOD = 0xFFFE;
+  static_assert(MaxNodes < WRONG_METHOD, "node index must fit in Index");
+
+  template <typename Def, size_t N>
+  constexpr explicit RouteTrie(const std::array<Def, N>& defs)
+      : RouteTrie(defs.data(), N) {
+    static_assert(N < WRONG_METHOD, "route index must fit in Index");
+  }
+
+  template <typename Def>
+  constexpr RouteTrie(const Def* defs, size_t count) {
+    _nodes[0] = Node{};
+    for (size_t i = 0; i < count && _error == nullptr; ++i) {
+      insert(defs[i].method, defs[i].pattern, static_cast<Index>(i));
+    }
+  }
+
+  // Index of the route for `method` on `path`; WRONG_METHOD when the path
+  // exists under another method, NONE when it does not exist at all. A
+  // trailing slash is ignored.
+  Index match(RouteMethod method, std::string_view path,
+              RouteParams& params) const {
+    if (path.empty() || path.front() != '/') return NONE;
+    path.remove_prefix(1);
+    params.count = 0;
+    return walk(0, method, path, params);
+  }
+
+  // Set when the table has a malformed or duplicate pattern; checked with a
+  // static_assert where the table is defined.
+  [[nodiscard]] constexpr const char* error() const { return _error; }
+  [[nodiscard]] constexpr size_t nodeCount() const { return _count; }
+
+ private:
+  struct Node {
+    std::string_view segment{};
+    ParamType param = ParamType::None;
+    Index firstChild = NONE;
+    Index nextSibling = NONE;
+    std::array<Index, static_cast<size_t>(RouteMethod::Count)> routes{
+        NONE, NONE, NONE};
+  };
+
+  std::array<Node, MaxNodes> _nodes{};
+  size_t _count = 1;
+  const char* _error = nullptr;
+
+  static constexpr ParamType paramType(std::string_view segment) {
+    if (segment.size() < 3 || segment.front() != '{' ||
+        segment.back() != '}') {
+      return ParamType::None;
+    }
+    const size_t colon = segment.find(':');
+    if (colon == std::string_view::npos) return ParamType::Text;
+    return segment.substr(colon + 1, segment.size() - colon - 2) == "uint"
+               ? ParamType::Uint
+               : ParamType::None;
+  }
+
+  constexpr Index child(Index parent, std::string_view segment,
+                        ParamType param) {
+    Index last = NONE;
+    for (Index i = _nodes[parent].firstChild; i != NONE;
+         i = _nodes[i].nextSibling) {
+      const Node& node = _nodes[i];
+      if (node.param == param &&
+          (param != ParamType::None || node.segment == segment)) {
+        return i;
+      }
+      last = i;
+    }
+    if (_count == MaxNodes) {
+      _error = "route trie capacity exceeded";
+      return NONE;
+    }
+    const auto index = static_cast<Index>(_count++);
+    _nodes[index].segment = param == ParamType::None ? segment : "";
+    _nodes[index].param = param;
+    if (last == NONE) {
+      _nodes[parent].firstChild = index;
+    } else {
+      _nodes[last].nextSibling = index;
+    }
+    return index;
+  }
+
+  constexpr void insert(RouteMethod method, std::string_view pattern,
+                        Index route) {
+    if (pattern.empty() || pattern.front() != '/') {
+      _error = "route pattern must start with /";
+      return;
+    }
+    pattern.remove_prefix(1);
+    Index node = 0;
+    while (!pattern.empty()) {
+      const size_t slash = pattern.find('/');
+      const std::string_view segment = pattern.substr(0, slash);
+      pattern = slash == std::string_view::npos ? std::string_view{}
+                                                : pattern.substr(slash + 1);
+      if (segment.empty()) {
+        _error = "route pattern has an empty segment";
+        return;
+      }
+      const ParamType param = paramType(segment);
+      if (param == ParamType::None && segment.front() == '{') {
+        _error = "unknown route parameter type";
+        return;
+      }
+      node = child(node, segment, param);
+      if (node == NONE) return;
+    }
+    Index& slot = _nodes[node].routes[static_cast<size_t>(method)];
+    if (slot != NONE) {
+      _error = "duplicate route";
+      return;
+    }
+    slot = route;
+  }
+
+  static bool parseUint(std::string_view text, uint32_t& out) {
+    if (text.empty() || text.size() > 10) return false;
+    uint64_t value = 0;
+    for (const char c : text) {
+      if (c < '0' || c > '9') return false;
+      value = value * 10 + static_cast<uint64_t>(c - '0');
+    }
+    if (value > UINT32_MAX) return false;
+    out = static_cast<uint32_t>(value);
+    return true;
+  }
+
+  Index walk(Index index, RouteMethod method, std::string_view rest,
+             RouteParams& params) const {
+    const Node& node = _nodes[index];
+    if (rest.empty()) {
+      if (method != RouteMethod::Count) {
+        const Index route = node.routes[static_cast<size_t>(method)];
+        if (route != NONE) return route;
+      }
+      for (const Index other : node.routes) {
+        if (other != NONE) return WRONG_METHOD;
+      }
+      return NONE;
+    }
+
+    const size_t slash = rest.find('/');
+    const std::string_view segment = rest.substr(0, slash);
+    const std::string_view tail =
+        slash == std::string_view::npos ? std::string_view{}
+                                        : rest.substr(slash + 1);
+    if (segment.empty()) return NONE;
+
+    Index best = NONE;
+    for (Index i = node.firstChild; i != NONE; i = _nodes[i].nextSibling) {
+      if (_nodes[i].param == ParamType::None && _nodes[i].segment == segment) {
+        best = walk(i, method, tail, params);
+        if (best < WRONG_METHOD) return best;
+        break;
+      }
+    }
+    if (params.count == MAX_ROUTE_PARAMS) return best;
+    for (Index i = node.firstChild; i != NONE; i = _nodes[i].nextSibling) {
+      const ParamType param = _nodes[i].param;
+      if (param == ParamType::None) continue;
+      const uint8_t slot = params.count;
+      if (param == ParamType::Uint &&
+          !parseUint(segment, params.number[slot])) {
+        continue;
+      }
+      params.text[slot] = segment;
+      params.count = slot + 1;
+      const Index found = walk(i, method, tail, params);
+      if (found < WRONG_METHOD) return found;
+      params.count = slot;
+      if (found == WRONG_METHOD) best = WRONG_METHOD;
+    }
+    return best;
+  }
+};
+
+// Upper bound on trie nodes for a table: the root plus one per segment.
+template <typename Def, size_t N>
+constexpr size_t routeTrieCapacity(const std::array<Def, N>& defs) {
+  size_t nodes = 1;
+  for (const Def& def : defs) {
+    for (const char c : def.pattern) {
+      if (c == '/') ++nodes;
+    }
+  }
+  return nodes;
+}
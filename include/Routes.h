@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Metrics.h"
+#include "Profiler.h"
+#include "RouteTrie.h"
+
+#include <array>
+#include <string_view>
+
+enum class RouteBody : uint8_t { None, Json, Stream };
+
+struct RouteDef {
+  RouteMethod method;
+  std::string_view pattern;
+  Metrics::Route route;
+  RouteBody body = RouteBody::None;
+  // Admission tokens per request; 0 when the cost depends on the query.
+  uint8_t cost = 1;
+};
+
+// Every HTTP route of the device except the /api/wifi/events SSE stream,
+// which AsyncEventSource serves itself. The dispatcher trie is built from
+// this table at compile time, so a duplicate or malformed pattern fails the
+// build.
+namespace Routes {
+
+using Metrics::Route;
+using enum RouteMethod;
+
+inline constexpr auto TABLE = std::to_array<RouteDef>({
+    {Get, "/", Route::Root},
+    {Get, "/setup", Route::Setup},
+    {Get, "/api/state", Route::State},
+    {Get, "/api/batch", Route::Batch, RouteBody::None, 0},
+    {Get, "/metrics", Route::Metrics, RouteBody::None, 2},
+    {Get, "/api/trace", Route::Trace},
+    {Get, "/api/heap", Route::Heap},
+#if PROFILER_ENABLED
+    {Get, "/api/profile", Route::Profile},
+#endif
+    {Get, "/api/config/schema", Route::ConfigSchema},
+    {Get, "/api/config/thermal", Route::ThermalGet},
+    {Post, "/api/config/thermal", Route::ThermalSet, RouteBody::Json},
+    {Get, "/api/config/security", Route::SecurityGet},
+    {Post, "/api/config/security", Route::SecuritySet, RouteBody::Json},
+    {Get, "/api/users", Route::UsersGet},
+    {Post, "/api/users", Route::UsersUpsert, RouteBody::Json},
+    {Get, "/api/users/export", Route::UsersExport},
+    {Post, "/api/users/import", Route::UsersImport, RouteBody::Stream, 2},
+    {Delete, "/api/users/{userId}", Route::UsersDelete},
+    {Get, "/api/access-log", Route::AccessLog, RouteBody::None, 2},
+    {Get, "/api/export", Route::Export, RouteBody::None, 2},
+    {Post, "/api/send", Route::SendNow},
+    {Get, "/api/wifi/scan", Route::WiFiScan, RouteBody::None, 4},
+    {Post, "/api/wifi/connect", Route::WiFiConnect, RouteBody::Json},
+    {Get, "/api/wifi/job", Route::WiFiJob},
+    {Get, "/api/wifi/job/{id:uint}", Route::WiFiJob},
+});
+
+using Trie = RouteTrie<routeTrieCapacity(TABLE)>;
+inline constexpr Trie TRIE(TABLE);
+static_assert(TRIE.error() == nullptr, "invalid route table");
+
+}  // namespace Routes
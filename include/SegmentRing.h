@@ -0,0 +1,196 @@
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include <algorithm>
+#include <mutex>
+#include <type_traits>
+
+// Fixed-size records appended to segment files <dir>/<n>.bin and kept as a
+// ring: starting segment n removes segment n - MaxSegments. A record is
+// addressed by a sequence number that never repeats and is never rewritten
+// once below nextSeq(), so read() does its file I/O without the lock.
+// Owners keep their own index over the records; the hooks that maintain and
+// consult it run with the ring locked.
+template <typename Record, size_t SegmentRecords, size_t MaxSegments>
+class SegmentRing {
+  static_assert(std::is_trivially_copyable_v<Record>,
+                "records are stored verbatim");
+
+ public:
+  static constexpr size_t READ_BATCH = 16;
+  static constexpr size_t MAX_SCAN_PER_READ = 1024;
+
+  explicit SegmentRing(const char* dir) : _dir(dir) {}
+
+  // Removes segments that fell out of the ring, then replays every kept
+  // one through reset(segment) and note(seq, record).
+  template <typename Reset, typename Note>
+  bool begin(Reset&& reset, Note&& note) {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!LittleFS.exists(_dir) && !LittleFS.mkdir(_dir)) return false;
+
+    bool found = false;
+    uint32_t minSegment = UINT32_MAX;
+    uint32_t maxSegment = 0;
+    File dir = LittleFS.open(_dir);
+    for (File entry = dir.openNextFile(); entry; entry = dir.openNextFile()) {
+      uint32_t segment = 0;
+      if (!parseSegmentName(entry.name(), segment)) continue;
+      found = true;
+      minSegment = std::min(minSegment, segment);
+      maxSegment = std::max(maxSegment, segment);
+    }
+    dir.close();
+
+    if (found) {
+      const uint32_t oldestKept =
+          maxSegment >= MaxSegments ? maxSegment - MaxSegments + 1 : 0;
+      for (uint32_t segment = minSegment; segment < oldestKept; ++segment) {
+        LittleFS.remove(segmentPath(segment));
+      }
+      const uint32_t first = std::max(minSegment, oldestKept);
+      for (uint32_t segment = first; segment <= maxSegment; ++segment) {
+        reset(segment);
+        replay(segment, note);
+      }
+      File last = LittleFS.open(segmentPath(maxSegment), "r");
+      const size_t records = last ? last.size() / sizeof(Record) : 0;
+      last.close();
+      _firstSeq = first * SegmentRecords;
+      _nextSeq = maxSegment * SegmentRecords + records;
+    }
+    _ready = true;
+    return true;
+  }
+
+  // Calls reset(segment) when a record opens a new segment, after the oldest
+  // one is dropped; make() runs after that, so it sees the index the record
+  // will land in. The written record is passed to note(seq, record).
+  template <typename Make, typename Reset, typename Note>
+  bool append(Make&& make, Reset&& reset, Note&& note) {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_ready) return false;
+
+    const uint32_t segment = _nextSeq / SegmentRecords;
+    const bool fresh = _nextSeq % SegmentRecords == 0;
+    if (fresh) {
+      if (segment >= MaxSegments) {
+        LittleFS.remove(segmentPath(segment - MaxSegments));
+        _firstSeq = (segment - MaxSegments + 1) * SegmentRecords;
+      }
+      reset(segment);
+    }
+
+    const Record record = make();
+    File file = LittleFS.open(segmentPath(segment), fresh ? "w" : "a");
+    if (!file || file.write(reinterpret_cast<const uint8_t*>(&record),
+                            sizeof(record)) != sizeof(record)) {
+      ++_writeErrors;
+      return false;
+    }
+    file.close();
+    note(_nextSeq, record);
+    ++_nextSeq;
+    return true;
+  }
+
+  // Reads from `cursor` towards `endSeq`, scanning at most MAX_SCAN_PER_READ
+  // records and opening each segment file once. skip(cursor) runs locked and
+  // returns the first cursor the owner's index cannot rule out.
+  // visit(seq, record) returns true for a record it kept; reading stops once
+  // `max` are kept, with `cursor` just past the last one.
+  template <typename Skip, typename Visit>
+  size_t read(uint32_t& cursor, uint32_t endSeq, size_t max, Skip&& skip,
+              Visit&& visit) {
+    size_t kept = 0;
+    size_t scanned = 0;
+    File file;
+    uint32_t openSegment = UINT32_MAX;
+    Record batch[READ_BATCH];
+    while (kept < max && scanned < MAX_SCAN_PER_READ) {
+      {
+        std::lock_guard<std::mutex> guard(_lock);
+        cursor = skip(std::max(cursor, _firstSeq));
+      }
+      if (cursor >= endSeq) break;
+
+      const uint32_t segment = cursor / SegmentRecords;
+      if (segment != openSegment) {
+        file.close();
+        file = LittleFS.open(segmentPath(segment), "r");
+        openSegment = segment;
+      }
+      const uint32_t segmentEnd =
+          std::min<uint32_t>((segment + 1) * SegmentRecords, endSeq);
+      const size_t want = std::min<size_t>(segmentEnd - cursor, READ_BATCH);
+      size_t got = 0;
+      if (file && file.seek((cursor % SegmentRecords) * sizeof(Record))) {
+        got = file.read(reinterpret_cast<uint8_t*>(batch),
+                        want * sizeof(Record)) /
+              sizeof(Record);
+      }
+
+      size_t consumed = 0;
+      while (consumed < got && kept < max) {
+        if (visit(cursor + static_cast<uint32_t>(consumed), batch[consumed])) {
+          ++kept;
+        }
+        ++consumed;
+      }
+      cursor += got == 0 ? want : consumed;
+      scanned += want;
+    }
+    file.close();
+    return kept;
+  }
+
+  // For owner state that has to be read together with the ring's.
+  template <typename Fn>
+  decltype(auto) locked(Fn&& fn) {
+    std::lock_guard<std::mutex> guard(_lock);
+    return fn();
+  }
+
+  [[nodiscard]] uint32_t firstSeq() const { return _firstSeq; }
+  [[nodiscard]] uint32_t nextSeq() const { return _nextSeq; }
+  [[nodiscard]] uint32_t writeErrors() const { return _writeErrors; }
+
+ private:
+  const char* _dir;
+  std::mutex _lock;
+  bool _ready = false;
+  uint32_t _firstSeq = 0;
+  uint32_t _nextSeq = 0;
+  uint32_t _writeErrors = 0;
+
+  template <typename Note>
+  void replay(uint32_t segment, Note& note) {
+    File file = LittleFS.open(segmentPath(segment), "r");
+    if (!file) return;
+    Record batch[READ_BATCH];
+    uint32_t seq = segment * SegmentRecords;
+    size_t got = 0;
+    while ((got = file.read(reinterpret_cast<uint8_t*>(batch),
+                            sizeof(batch)) /
+                  sizeof(Record)) > 0) {
+      for (size_t i = 0; i < got; ++i) note(seq++, batch[i]);
+    }
+    file.close();
+  }
+
+  String segmentPath(uint32_t segment) const {
+    return String(_dir) + "/" + String(segment) + ".bin";
+  }
+
+  static bool parseSegmentName(const char* name, uint32_t& segment) {
+    const char* base = strrchr(name, '/');
+    base = base != nullptr ? base + 1 : name;
+    char* end = nullptr;
+    const unsigned long value = strtoul(base, &end, 10);
+    if (end == base || strcmp(end, ".bin") != 0) return false;
+    segment = static_cast<uint32_t>(value);
+    return true;
+  }
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "SegmentRing.h"
+
+#include <Arduino.h>
+
+#include <array>
+
+enum SensorFlag : uint8_t {
+  SENSOR_FLAG_FAN1 = 1 << 0,
+  SENSOR_FLAG_FAN2 = 1 << 1,
+  SENSOR_FLAG_ALARM = 1 << 2,
+};
+
+// Temperature and humidity in hundredths, so a record is a fixed 12 bytes.
+struct SensorRecord {
+  uint32_t epoch = 0;
+  int16_t temperatureCenti = 0;
+  uint16_t humidityCenti = 0;
+  uint8_t flags = 0;
+  uint8_t reserved[3] = {};
+};
+static_assert(sizeof(SensorRecord) == 12, "SensorRecord is stored verbatim");
+
+struct SensorQuery {
+  uint32_t from = 0;
+  uint32_t to = UINT32_MAX;
+  uint32_t cursor = 0;
+  uint32_t endSeq = 0;
+};
+
+// Periodic sensor samples in a SegmentRing under /history. Samples are
+// appended in time order, so an epoch range per segment is enough to skip to
+// the start of a query.
+class SensorHistory {
+ public:
+  static constexpr size_t SEGMENT_RECORDS = 1024;
+  static constexpr size_t MAX_SEGMENTS = 4;
+  static constexpr unsigned long SAMPLE_INTERVAL_MS = 60000;
+
+  bool begin();
+  void append(const SensorRecord& record);
+
+  [[nodiscard]] SensorQuery makeQuery(uint32_t from, uint32_t to);
+  size_t read(SensorQuery& query, SensorRecord* out, size_t max);
+
+  [[nodiscard]] uint32_t firstSeq() const { return _ring.firstSeq(); }
+  [[nodiscard]] uint32_t nextSeq() const { return _ring.nextSeq(); }
+  [[nodiscard]] uint32_t writeErrors() const { return _ring.writeErrors(); }
+
+ private:
+  struct SegmentIndex {
+    uint32_t minEpoch = UINT32_MAX;
+    uint32_t maxEpoch = 0;
+  };
+
+  SegmentRing<SensorRecord, SEGMENT_RECORDS, MAX_SEGMENTS> _ring{"/history"};
+  std::array<SegmentIndex, MAX_SEGMENTS> _segments{};
+
+  void resetSegment(uint32_t segment);
+  void noteRecord(uint32_t seq, const SensorRecord& record);
+  [[nodiscard]] bool segmentMatches(uint32_t segment, uint32_t from,
+                                    uint32_t to) const;
+};
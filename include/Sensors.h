@@ -1,14 +1,17 @@
 #pragma once
 
+#include "FixedPoint.h"
 #include "PinMap.h"
 
 #include <Arduino.h>
 #include <HTU2xD_SHT2x_Si70xx.h>
 
+// Temperature in 0.01 °C, relative humidity in 0.01 %.
 struct SensorData {
-  float temperature;
-  float humidity;
+  int16_t temperatureCenti;
+  uint16_t humidityCenti;
   bool valid;
+  unsigned long sampledAtMs;
 };
 
 class SHT21Sensor {
@@ -18,10 +21,12 @@ class SHT21Sensor {
   [[nodiscard]] bool begin();
   [[nodiscard]] SensorData read();
   [[nodiscard]] bool isReady() const { return _ready; }
+  [[nodiscard]] uint32_t errorCount() const { return _errorCount; }
 
  private:
   HTU2xD_SHT2x_SI70xx _sht;
   bool _ready = false;
+  uint32_t _errorCount = 0;
 };
 
 class SensorManager {
@@ -32,6 +37,7 @@ class SensorManager {
   void setReadIntervalMs(unsigned long intervalMs) { _readIntervalMs = intervalMs; }
   void update();
   [[nodiscard]] SensorData getData() const;
+  [[nodiscard]] uint32_t errorCount() const { return _sht21.errorCount(); }
 
  private:
   SHT21Sensor _sht21;
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+#include <atomic>
+#include <type_traits>
+
+// Single-writer sequence lock for small POD snapshots. Readers never take a
+// lock: they copy the value and retry if the sequence moved underneath them.
+// The writer keeps preemption off on its core for the copy, so a reader task
+// on the same core can never spin against a half-finished write.
+template <typename T>
+class SeqLock {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "SeqLock values must be trivially copyable");
+
+ public:
+  void store(const T& value) {
+    portENTER_CRITICAL(&_writer);
+    const uint32_t seq = _seq.load(std::memory_order_relaxed);
+    _seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _value = value;
+    _seq.store(seq + 2, std::memory_order_release);
+    portEXIT_CRITICAL(&_writer);
+  }
+
+  [[nodiscard]] T load() const {
+    for (;;) {
+      const uint32_t before = _seq.load(std::memory_order_acquire);
+      if ((before & 1) != 0) continue;
+      T copy = _value;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (_seq.load(std::memory_order_relaxed) == before) return copy;
+    }
+  }
+
+ private:
+  T _value{};
+  std::atomic<uint32_t> _seq{0};
+  portMUX_TYPE _writer = portMUX_INITIALIZER_UNLOCKED;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+#ifndef TRACE_CAPACITY
+#define TRACE_CAPACITY 1024
+#endif
+
+namespace Trace {
+
+void begin(const char* name);
+void end(const char* name);
+// One complete event for a span that started at `startUs` (micros()), kept
+// only if it ran for at least `minUs`. Hot paths use this so their fast
+// passes do not push everything else out of the ring.
+void slow(const char* name, uint32_t startUs, uint32_t minUs);
+
+class Scope {
+ public:
+  explicit Scope(const char* name) : _name(name) { begin(_name); }
+  ~Scope() { end(_name); }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  const char* _name;
+};
+
+// Recording pauses while an exporter is alive so the ring it walks holds
+// still; a slow chunked download would otherwise lose most slots.
+class ChromeExporter {
+ public:
+  ChromeExporter();
+  ~ChromeExporter();
+  ChromeExporter(const ChromeExporter&) = delete;
+  ChromeExporter& operator=(const ChromeExporter&) = delete;
+
+  size_t fill(uint8_t* buf, size_t maxLen);
+
+ private:
+  enum class Stage : uint8_t { Header, Events, Footer, Done };
+
+  Stage _stage = Stage::Header;
+  uint32_t _cursor = 0;
+  uint32_t _end = 0;
+  bool _first = true;
+  char _line[160];
+  size_t _lineLen = 0;
+  size_t _lineOffset = 0;
+
+  bool nextLine();
+};
+
+}  // namespace Trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#if TRACE_ENABLED
+#define TRACE_BEGIN(name) Trace::begin(name)
+#define TRACE_END(name) Trace::end(name)
+#define TRACE_SCOPE(name) \
+  Trace::Scope TRACE_CONCAT(_traceScope, __LINE__)(name)
+#define TRACE_SLOW(name, startUs, minUs) Trace::slow(name, startUs, minUs)
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SLOW(name, startUs, minUs) ((void)0)
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "GoogleSheetsClient.h"
+#include "HeapTracker.h"
+
+#include <Arduino.h>
+#include <array>
+#include <variant>
+
+enum class UploadClass : uint8_t { Urgent, Access, Telemetry, Count };
+
+enum class OverflowPolicy : uint8_t {
+  KeepNewest,
+  KeepOldest,
+  Downsample,
+  Coalesce
+};
+
+// Payloads hold no heap pointers, so the lane's tracked deque storage is
+// everything a queued upload costs.
+struct UploadItem {
+  std::variant<TelemetryLogPayload, AccessLogPayload> payload;
+  unsigned long enqueuedMs = 0;
+};
+
+struct ClassPolicy {
+  uint8_t weight = 1;
+  bool preempt = false;
+  uint16_t capacity = 300;
+  OverflowPolicy overflow = OverflowPolicy::KeepNewest;
+  unsigned long agingMs = 30000;
+};
+
+struct LatencyPercentiles {
+  uint32_t p50 = 0;
+  uint32_t p90 = 0;
+  uint32_t p99 = 0;
+  uint32_t max = 0;
+  size_t samples = 0;
+};
+
+class UploadScheduler {
+ public:
+  static constexpr size_t CLASS_COUNT = static_cast<size_t>(UploadClass::Count);
+
+  void configure(UploadClass cls, const ClassPolicy& policy);
+
+  bool enqueue(UploadClass cls, UploadItem item);
+  [[nodiscard]] UploadClass next(unsigned long nowMs) const;
+  [[nodiscard]] const UploadItem& front(UploadClass cls) const;
+  void complete(UploadClass cls, unsigned long nowMs);
+
+  [[nodiscard]] bool empty() const;
+  [[nodiscard]] size_t size(UploadClass cls) const;
+  [[nodiscard]] uint32_t dropped(UploadClass cls) const;
+  [[nodiscard]] uint32_t coalesced(UploadClass cls) const;
+  [[nodiscard]] LatencyPercentiles percentiles(UploadClass cls) const;
+
+  static const char* className(UploadClass cls);
+
+ private:
+  static constexpr size_t LATENCY_WINDOW = 64;
+
+  struct Lane {
+    ClassPolicy policy;
+    TrackedDeque<UploadItem, HeapTag::Network> items;
+    std::array<uint32_t, LATENCY_WINDOW> latencies{};
+    uint8_t latencyHead = 0;
+    uint8_t latencyCount = 0;
+    uint32_t dropped = 0;
+    uint32_t coalesced = 0;
+  };
+
+  std::array<Lane, CLASS_COUNT> _lanes;
+
+  Lane& lane(UploadClass cls) { return _lanes[static_cast<size_t>(cls)]; }
+  const Lane& lane(UploadClass cls) const {
+    return _lanes[static_cast<size_t>(cls)];
+  }
+  static void downsample(Lane& lane);
+  static bool coalesce(Lane& lane);
+};
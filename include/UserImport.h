@@ -0,0 +1,76 @@
+#pragma once
+
+#include "AccessController.h"
+#include "Config.h"
+
+#include <Arduino.h>
+
+#include <array>
+
+struct ImportError {
+  uint32_t line = 0;
+  const char* reason = "";
+};
+
+// Parses a user list fed in arbitrary body chunks, one record per line:
+// NDJSON objects with the POST /api/users fields, or CSV
+// `userId,displayName,pin,enabled` with an optional header row. Rows are
+// validated and their PINs hashed as they arrive, so only the staged
+// credentials and one line are ever held in RAM. An empty PIN keeps the
+// stored one; a repeated userId replaces the earlier row.
+class UserImport {
+ public:
+  static constexpr size_t LINE_CAPACITY = 160;
+  static constexpr size_t MAX_ERRORS = 8;
+  static constexpr size_t USER_ID_MAX = sizeof(AccessEvent::userId) - 1;
+  static constexpr size_t DISPLAY_NAME_MAX =
+      sizeof(AccessEvent::displayName) - 1;
+
+  void feed(const uint8_t* data, size_t len);
+  // Parses a last line that has no trailing newline.
+  void finish();
+
+  [[nodiscard]] const UserCredential* users() const { return _users.data(); }
+  [[nodiscard]] size_t userCount() const { return _userCount; }
+  [[nodiscard]] uint32_t lineOf(size_t index) const {
+    return _userLines[index];
+  }
+  [[nodiscard]] uint32_t lines() const { return _lineNo; }
+  [[nodiscard]] uint32_t rejected() const { return _rejected; }
+  [[nodiscard]] size_t bytes() const { return _bytes; }
+  [[nodiscard]] size_t errorCount() const { return _errorCount; }
+  [[nodiscard]] const ImportError& error(size_t index) const {
+    return _errors[index];
+  }
+
+ private:
+  struct Row {
+    const char* userId = "";
+    const char* displayName = "";
+    const char* pin = "";
+    bool enabled = true;
+  };
+
+  std::array<UserCredential, MAX_USERS> _users;
+  std::array<uint32_t, MAX_USERS> _userLines{};
+  size_t _userCount = 0;
+
+  char _line[LINE_CAPACITY];
+  size_t _lineLen = 0;
+  bool _lineTooLong = false;
+  bool _sawRow = false;
+  uint32_t _lineNo = 0;
+  size_t _bytes = 0;
+
+  uint32_t _rejected = 0;
+  std::array<ImportError, MAX_ERRORS> _errors{};
+  size_t _errorCount = 0;
+
+  void endLine();
+  void parseLine(char* line);
+  bool parseCsv(char* line, Row& row, const char*& reason);
+  bool parseJson(const char* line, Row& row, JsonDocument& doc,
+                 const char*& reason);
+  void stage(const Row& row);
+  void reject(const char* reason);
+};
@@ -66,6 +66,7 @@ constexpr const char SETUP_HTML[] PROGMEM = R"rawliteral(
     <div class="card">
       <h1>Smart Server <span>Pengaturan</span></h1>
       <div class="row" style="margin-top:0"><a href="/" style="text-decoration:none"><button>&larr; Dashboard</button></a></div>
+      <div class="status" id="page-status"></div>
     </div>
 
     <div class="card">
@@ -81,26 +82,15 @@ constexpr const char SETUP_HTML[] PROGMEM = R"rawliteral(
 
     <div class="card">
       <h2>Konfigurasi Termal</h2>
-      <div class="grid">
-        <div><label>Ambang Peringatan (C)</label><input id="warn-th" type="number" step="0.1"></div>
-        <div><label>Ambang Alarm (C)</label><input id="stage2-th" type="number" step="0.1"></div>
-        <div><label>Kipas 1 Dasar</label><select id="fan1-baseline"><option value="true">NYALA</option><option value="false">MATI</option></select></div>
-        <div><label>Interval Sensor (d)</label><input id="sensor-int" type="number" min="1"></div>
-        <div><label>Interval Cloud (d)</label><input id="cloud-int" type="number" min="10"></div>
-      </div>
-      <div class="row"><button onclick="saveThermal()">Simpan Termal</button></div>
+      <div class="grid" id="thermal-fields"></div>
+      <div class="row"><button onclick="saveConfigGroup('thermal')">Simpan Termal</button></div>
       <div class="status" id="thermal-status"></div>
     </div>
 
     <div class="card">
       <h2>Konfigurasi Keamanan</h2>
-      <div class="grid">
-        <div><label>Maks Percobaan Gagal</label><input id="max-fail" type="number" min="1"></div>
-        <div><label>Penguncian (d)</label><input id="lockout-sec" type="number" min="10"></div>
-        <div><label>Buka Solenoid (d)</label><input id="unlock-sec" type="number" min="1"></div>
-        <div><label>ID Perangkat</label><input id="device-id" type="text"></div>
-      </div>
-      <div class="row"><button onclick="saveSecurity()">Simpan Keamanan</button></div>
+      <div class="grid" id="security-fields"></div>
+      <div class="row"><button onclick="saveConfigGroup('security')">Simpan Keamanan</button></div>
       <div class="status" id="security-status"></div>
     </div>
 
@@ -125,33 +115,50 @@ constexpr const char SETUP_HTML[] PROGMEM = R"rawliteral(
 
   <script>
     let selectedSsid = "";
+    let configEtag = null;
     async function fetchJson(url, options) {
       const res = await fetch(url, options || {});
+      configEtag = res.headers.get("ETag") || configEtag;
       const txt = await res.text();
       try { return JSON.parse(txt); } catch { return { raw: txt, ok: res.ok }; }
     }
+    // Writes carry the config version this page last saw; if another admin
+    // saved in between the device answers 412 instead of overwriting.
+    async function writeConfig(url, method, payload) {
+      const headers = {};
+      if (payload !== undefined) headers["Content-Type"] = "application/json";
+      if (configEtag) headers["If-Match"] = configEtag;
+      const res = await fetch(url, {
+        method, headers, body: payload === undefined ? undefined : JSON.stringify(payload)
+      });
+      if (res.ok) configEtag = res.headers.get("ETag") || configEtag;
+      return res;
+    }
+    const STALE_MSG = "Diubah admin lain, muat ulang halaman";
     function setStatus(id, msg, isError=false) {
       const el = document.getElementById(id);
       el.style.color = isError ? "#f87171" : "#34d399";
       el.textContent = msg;
     }
+    function renderNetworks(data) {
+      const list = document.getElementById("wifi-list");
+      list.innerHTML = "";
+      (data.networks || []).forEach(n => {
+        const div = document.createElement("div");
+        div.className = "wifi-item";
+        div.textContent = `${n.ssid} (${n.rssi} dBm)`;
+        div.onclick = () => {
+          selectedSsid = n.ssid;
+          document.querySelectorAll(".wifi-item").forEach(x => x.classList.remove("active"));
+          div.classList.add("active");
+        };
+        list.appendChild(div);
+      });
+    }
     async function scanWifi() {
       setStatus("wifi-status", "Memindai...");
       try {
-        const data = await fetchJson("/api/wifi/scan");
-        const list = document.getElementById("wifi-list");
-        list.innerHTML = "";
-        (data.networks || []).forEach(n => {
-          const div = document.createElement("div");
-          div.className = "wifi-item";
-          div.textContent = `${n.ssid} (${n.rssi} dBm)`;
-          div.onclick = () => {
-            selectedSsid = n.ssid;
-            document.querySelectorAll(".wifi-item").forEach(x => x.classList.remove("active"));
-            div.classList.add("active");
-          };
-          list.appendChild(div);
-        });
+        renderNetworks(await fetchJson("/api/wifi/scan"));
         setStatus("wifi-status", "Pindai selesai");
       } catch (e) {
         setStatus("wifi-status", "Pindai gagal", true);
@@ -165,55 +172,105 @@ constexpr const char SETUP_HTML[] PROGMEM = R"rawliteral(
         headers: { "Content-Type": "application/json" },
         body: JSON.stringify({ ssid: selectedSsid, password: pass })
       });
-      if (data.success) setStatus("wifi-status", "Terhubung: " + data.ip);
-      else setStatus("wifi-status", data.error || "Gagal terhubung", true);
-    }
-    async function loadThermal() {
-      const c = await fetchJson("/api/config/thermal");
-      document.getElementById("warn-th").value = c.warnThreshold ?? 27;
-      document.getElementById("stage2-th").value = c.stage2Threshold ?? 28;
-      document.getElementById("fan1-baseline").value = String(c.fan1BaselineOn ?? true);
-      document.getElementById("sensor-int").value = c.sensorReadIntervalSec ?? 5;
-      document.getElementById("cloud-int").value = c.cloudSendIntervalSec ?? 60;
-    }
-    async function saveThermal() {
-      const payload = {
-        warnThreshold: parseFloat(document.getElementById("warn-th").value),
-        stage2Threshold: parseFloat(document.getElementById("stage2-th").value),
-        fan1BaselineOn: document.getElementById("fan1-baseline").value === "true",
-        sensorReadIntervalSec: parseInt(document.getElementById("sensor-int").value),
-        cloudSendIntervalSec: parseInt(document.getElementById("cloud-int").value)
-      };
-      const res = await fetch("/api/config/thermal", {
-        method: "POST",
-        headers: { "Content-Type": "application/json" },
-        body: JSON.stringify(payload)
-      });
-      setStatus("thermal-status", res.ok ? "Tersimpan" : "Gagal menyimpan", !res.ok);
+      if (!data.jobId) return setStatus("wifi-status", data.error || "Gagal terhubung", true);
+      setStatus("wifi-status", "Menghubungkan...");
+      watchWifiJob(data.jobId);
     }
-    async function loadSecurity() {
-      const c = await fetchJson("/api/config/security");
-      document.getElementById("max-fail").value = c.maxFail ?? 3;
-      document.getElementById("lockout-sec").value = c.lockoutSecs ?? 120;
-      document.getElementById("unlock-sec").value = c.unlockSecs ?? 10;
-      document.getElementById("device-id").value = c.deviceId ?? "";
+    function showWifiJob(job) {
+      if (job.state === "connected") setStatus("wifi-status", "Terhubung: " + job.ip);
+      else if (job.state === "failed") setStatus("wifi-status", job.error || "Gagal terhubung", true);
+      else setStatus("wifi-status", job.state === "verifying" ? "Memeriksa internet..." : "Menghubungkan...");
+      return job.state === "connected" || job.state === "failed";
     }
-    async function saveSecurity() {
-      const payload = {
-        maxFail: parseInt(document.getElementById("max-fail").value),
-        lockoutSecs: parseInt(document.getElementById("lockout-sec").value),
-        unlockSecs: parseInt(document.getElementById("unlock-sec").value),
-        deviceId: document.getElementById("device-id").value
+    function watchWifiJob(jobId) {
+      let done = false;
+      let es = null;
+      const finish = () => { done = true; if (es) es.close(); };
+      if (window.EventSource) {
+        es = new EventSource("/api/wifi/events");
+        es.addEventListener("job", ev => {
+          const job = JSON.parse(ev.data);
+          if (job.jobId === jobId && showWifiJob(job)) finish();
+        });
+      }
+      const poll = async () => {
+        if (done) return;
+        try {
+          const job = await fetchJson(`/api/wifi/job/${jobId}`);
+          if (job.jobId === jobId && showWifiJob(job)) return finish();
+        } catch (e) {}
+        setTimeout(poll, 1000);
       };
-      const res = await fetch("/api/config/security", {
-        method: "POST",
-        headers: { "Content-Type": "application/json" },
-        body: JSON.stringify(payload)
+      setTimeout(poll, 1000);
+    }
+    let configSchema = null;
+    function loadConfigSchema() {
+      configSchema = configSchema || fetchJson("/api/config/schema");
+      return configSchema;
+    }
+    function configInput(field, value) {
+      let input;
+      if (field.type === "bool") {
+        input = document.createElement("select");
+        input.innerHTML = '<option value="true">NYALA</option><option value="false">MATI</option>';
+        input.value = String(value ?? true);
+      } else {
+        input = document.createElement("input");
+        if (field.type === "text") {
+          input.type = "text";
+          input.maxLength = field.maxLen;
+        } else {
+          input.type = "number";
+          input.min = field.min;
+          input.max = field.max;
+          input.step = field.type === "float" ? "0.1" : "1";
+        }
+        input.value = value ?? "";
+      }
+      input.id = `cfg-${field.name}`;
+      return input;
+    }
+    async function loadConfigGroup(group) {
+      const [schema, values] = await Promise.all([
+        loadConfigSchema(), fetchJson(`/api/config/${group}`)
+      ]);
+      renderConfigGroup(group, schema, values);
+    }
+    function renderConfigGroup(group, schema, values) {
+      const box = document.getElementById(`${group}-fields`);
+      box.innerHTML = "";
+      (schema[group] || []).forEach(field => {
+        const cell = document.createElement("div");
+        const label = document.createElement("label");
+        label.textContent = field.label;
+        cell.append(label, configInput(field, values[field.name]));
+        box.appendChild(cell);
       });
-      setStatus("security-status", res.ok ? "Tersimpan" : "Gagal menyimpan", !res.ok);
+    }
+    async function saveConfigGroup(group) {
+      const schema = await loadConfigSchema();
+      const payload = {};
+      (schema[group] || []).forEach(field => {
+        const raw = document.getElementById(`cfg-${field.name}`).value;
+        if (field.type === "bool") payload[field.name] = raw === "true";
+        else if (field.type === "float") payload[field.name] = parseFloat(raw);
+        else if (field.type === "int") payload[field.name] = parseInt(raw);
+        else payload[field.name] = raw;
+      });
+      const res = await writeConfig(`/api/config/${group}`, "POST", payload);
+      let msg = "Tersimpan";
+      if (res.status === 412) {
+        msg = STALE_MSG;
+      } else if (!res.ok) {
+        const err = await res.json().catch(() => ({}));
+        msg = err.field ? `Nilai tidak valid: ${err.field}` : "Gagal menyimpan";
+      }
+      setStatus(`${group}-status`, msg, !res.ok);
     }
     async function loadUsers() {
-      const data = await fetchJson("/api/users");
+      renderUsers(await fetchJson("/api/users"));
+    }
+    function renderUsers(data) {
       const body = document.getElementById("users-body");
       body.innerHTML = "";
       (data.users || []).forEach(u => {
@@ -231,12 +288,10 @@ constexpr const char SETUP_HTML[] PROGMEM = R"rawliteral(
         pin: document.getElementById("u-pin").value.trim(),
         enabled: true
       };
-      const res = await fetch("/api/users", {
-        method: "POST",
-        headers: { "Content-Type": "application/json" },
-        body: JSON.stringify(payload)
-      });
-      if (res.ok) {
+      const res = await writeConfig("/api/users", "POST", payload);
+      if (res.status === 412) {
+        setStatus("users-status", STALE_MSG, true);
+      } else if (res.ok) {
         setStatus("users-status", "Pengguna tersimpan");
         document.getElementById("u-pin").value = "";
         loadUsers();
@@ -246,18 +301,36 @@ constexpr const char SETUP_HTML[] PROGMEM = R"rawliteral(
       }
     }
     async function deleteUser(userId) {
-      const res = await fetch(`/api/users/${encodeURIComponent(userId)}`, { method: "DELETE" });
-      if (res.ok) {
+      const res = await writeConfig(`/api/users/${encodeURIComponent(userId)}`, "DELETE");
+      if (res.status === 412) {
+        setStatus("users-status", STALE_MSG, true);
+      } else if (res.ok) {
         setStatus("users-status", "Pengguna dihapus");
         loadUsers();
       } else {
         setStatus("users-status", "Gagal menghapus", true);
       }
     }
-    scanWifi();
-    loadThermal();
-    loadSecurity();
-    loadUsers();
+    // Everything the page needs arrives in one /api/batch round trip; the
+    // per-section endpoints are only used by the reload and save buttons.
+    async function loadPage() {
+      const data = await fetchJson("/api/batch?r=wifi,schema,thermal,security,users");
+      if (!data.schema) {
+        await Promise.all([scanWifi(), loadConfigGroup("thermal"),
+                           loadConfigGroup("security"), loadUsers()]);
+      } else {
+        configSchema = Promise.resolve(data.schema);
+        configEtag = data.configEtag;
+        renderNetworks(data.wifi);
+        renderConfigGroup("thermal", data.schema, data.thermal);
+        renderConfigGroup("security", data.schema, data.security);
+        renderUsers(data.users);
+      }
+      window.pageReadyMs = Math.round(performance.now());
+      console.info("page ready", window.pageReadyMs, "ms");
+      setStatus("page-status", `Siap dalam ${window.pageReadyMs} ms`);
+    }
+    loadPage();
   </script>
 </body>
 </html>
@@ -305,6 +378,7 @@ constexpr const char DASHBOARD_HTML[] PROGMEM = R"rawliteral(
     }
     button:hover,a.btn:hover{transform:translateY(-1px);box-shadow:0 6px 16px rgba(79,143,255,0.35)}
     button:active{transform:translateY(0)}
+    canvas{display:block;width:100%;height:140px}
   </style>
 </head>
 <body>
@@ -323,23 +397,35 @@ constexpr const char DASHBOARD_HTML[] PROGMEM = R"rawliteral(
       </div>
       <div class="info" id="status">Memuat...</div>
       <div class="info" id="security">Keamanan: --</div>
+      <div class="info" id="thresholds">Ambang: --</div>
       <div class="actions">
         <button onclick="sendNow()">Kirim Sekarang</button>
         <a class="btn" href="/setup">Pengaturan</a>
       </div>
     </div>
+    <div class="card">
+      <div class="metric-label">Riwayat 24 Jam</div>
+      <canvas id="history"></canvas>
+      <div class="info" id="historyInfo">Memuat riwayat...</div>
+      <div class="actions">
+        <a class="btn" href="/api/export?kind=telemetry&format=csv">Unduh CSV Sensor</a>
+        <a class="btn" href="/api/export?kind=access&format=csv">Unduh CSV Akses</a>
+      </div>
+    </div>
   </div>
   <script>
+    function renderState(d) {
+      document.getElementById('temp').textContent = d.valid ? d.temperature.toFixed(1) + ' °C' : '--';
+      document.getElementById('hum').textContent = d.valid ? d.humidity.toFixed(1) + ' %' : '--';
+      document.getElementById('status').textContent =
+        `WiFi: ${d.wifiConnected ? 'ON' : 'OFF'}  |  K1: ${d.fan1On ? 'ON' : 'OFF'}  K2: ${d.fan2On ? 'ON' : 'OFF'}  |  Alarm: ${d.alarm ? 'YA' : 'TIDAK'}  |  Antrean: ${d.queueTelemetry}/${d.queueAccess}`;
+      document.getElementById('security').textContent =
+        `Keamanan: ${d.accessMessage || '-'}  |  Terkunci: ${d.lockoutActive ? ('YA ' + d.lockoutRemainingSec + 'd') : 'TIDAK'}  |  Pintu: ${d.doorState}`;
+    }
     async function refresh() {
       try {
         const res = await fetch('/api/state');
-        const d = await res.json();
-        document.getElementById('temp').textContent = d.valid ? d.temperature.toFixed(1) + ' °C' : '--';
-        document.getElementById('hum').textContent = d.valid ? d.humidity.toFixed(1) + ' %' : '--';
-        document.getElementById('status').textContent =
-          `WiFi: ${d.wifiConnected ? 'ON' : 'OFF'}  |  K1: ${d.fan1On ? 'ON' : 'OFF'}  K2: ${d.fan2On ? 'ON' : 'OFF'}  |  Alarm: ${d.alarm ? 'YA' : 'TIDAK'}  |  Antrean: ${d.queueTelemetry}/${d.queueAccess}`;
-        document.getElementById('security').textContent =
-          `Keamanan: ${d.accessMessage || '-'}  |  Terkunci: ${d.lockoutActive ? ('YA ' + d.lockoutRemainingSec + 'd') : 'TIDAK'}  |  Pintu: ${d.doorState}`;
+        renderState(await res.json());
       } catch (e) {
         document.getElementById('status').textContent = 'Kesalahan koneksi';
       }
@@ -348,7 +434,94 @@ constexpr const char DASHBOARD_HTML[] PROGMEM = R"rawliteral(
       await fetch('/api/send', { method: 'POST' });
       refresh();
     }
-    refresh();
+    // /api/export?format=bin: "SSXB" header, JSON metadata, then blocks of
+    // little-endian columns, each viewed in place as a typed array.
+    const COLUMN_TYPES = { u8: Uint8Array, u16: Uint16Array, i16: Int16Array, u32: Uint32Array };
+    function decodeExport(buf) {
+      const view = new DataView(buf);
+      if (view.getUint32(0) !== 0x53535842) throw new Error('bukan export biner');
+      const metaLen = view.getUint16(6, true);
+      const meta = JSON.parse(new TextDecoder().decode(new Uint8Array(buf, 8, metaLen)));
+      const parts = meta.columns.map(() => []);
+      let off = 8 + metaLen;
+      let rows = 0;
+      for (let n = view.getUint32(off, true); n > 0; n = view.getUint32(off, true)) {
+        off += 4;
+        meta.columns.forEach((c, i) => {
+          const T = COLUMN_TYPES[c.type];
+          parts[i].push(new T(buf, off, n));
+          off += (n * T.BYTES_PER_ELEMENT + 3) & ~3;
+        });
+        rows += n;
+      }
+      const columns = {};
+      const scales = {};
+      meta.columns.forEach((c, i) => {
+        const out = new COLUMN_TYPES[c.type](rows);
+        let at = 0;
+        for (const part of parts[i]) { out.set(part, at); at += part.length; }
+        columns[c.name] = out;
+        scales[c.name] = 10 ** c.scale;
+      });
+      return { meta, rows, columns, scales };
+    }
+    function drawHistory(d) {
+      const canvas = document.getElementById('history');
+      const info = document.getElementById('historyInfo');
+      const ratio = window.devicePixelRatio || 1;
+      const w = canvas.width = canvas.clientWidth * ratio;
+      const h = canvas.height = canvas.clientHeight * ratio;
+      const ctx = canvas.getContext('2d');
+      ctx.clearRect(0, 0, w, h);
+      if (d.rows < 2) {
+        info.textContent = 'Belum ada riwayat';
+        return;
+      }
+      const t = d.columns.epoch;
+      const temp = d.columns.temperature;
+      let lo = Infinity;
+      let hi = -Infinity;
+      for (const v of temp) { lo = Math.min(lo, v); hi = Math.max(hi, v); }
+      const span = Math.max(hi - lo, 1);
+      const tSpan = Math.max(t[d.rows - 1] - t[0], 1);
+      ctx.strokeStyle = '#4f8fff';
+      ctx.lineWidth = 2 * ratio;
+      ctx.beginPath();
+      for (let i = 0; i < d.rows; i++) {
+        const x = (t[i] - t[0]) / tSpan * w;
+        const y = h - 4 * ratio - (temp[i] - lo) / span * (h - 8 * ratio);
+        if (i === 0) ctx.moveTo(x, y); else ctx.lineTo(x, y);
+      }
+      ctx.stroke();
+      const k = d.scales.temperature;
+      info.textContent =
+        `Suhu: min ${(lo * k).toFixed(1)} °C  |  maks ${(hi * k).toFixed(1)} °C  |  ${d.rows} sampel`;
+    }
+    async function loadHistory() {
+      const from = Math.floor(Date.now() / 1000) - 86400;
+      try {
+        const res = await fetch(`/api/export?kind=telemetry&format=bin&from=${from}`);
+        if (!res.ok) throw new Error(res.status);
+        drawHistory(decodeExport(await res.arrayBuffer()));
+      } catch (e) {
+        document.getElementById('historyInfo').textContent = 'Riwayat tidak tersedia';
+      }
+    }
+    async function loadPage() {
+      try {
+        const res = await fetch('/api/batch?r=state,thermal');
+        const d = await res.json();
+        renderState(d.state);
+        document.getElementById('thresholds').textContent =
+          `Ambang: peringatan ${d.thermal.warnThreshold} °C  |  alarm ${d.thermal.stage2Threshold} °C`;
+      } catch (e) {
+        await refresh();
+      }
+      window.pageReadyMs = Math.round(performance.now());
+      console.info('page ready', window.pageReadyMs, 'ms');
+      loadHistory();
+    }
+    loadPage();
     setInterval(refresh, 3000);
   </script>
 </body>
@@ -1,16 +1,36 @@
 #pragma once
 
 #include "Config.h"
+#include "ConnectivityProbe.h"
+#include "HeapTracker.h"
 
 #include <Arduino.h>
 #include <DNSServer.h>
 #include <WiFi.h>
-#include <vector>
+#include <atomic>
+#include <mutex>
+
+enum class ConnectJobState : uint8_t {
+  Queued,
+  Connecting,
+  Verifying,
+  Connected,
+  Failed
+};
+
+struct ConnectJob {
+  uint32_t id = 0;
+  ConnectJobState state = ConnectJobState::Queued;
+  String ssid;
+  String error;
+  String ip;
+};
 
 class WiFiManager {
  public:
   enum class State : uint8_t {
     Idle,
+    FastConnecting,
     Scanning,
     Connecting,
     Verifying,
@@ -29,16 +49,25 @@ class WiFiManager {
   [[nodiscard]] String getSSID() const { return WiFi.SSID(); }
   [[nodiscard]] int32_t getRSSI() const { return WiFi.RSSI(); }
   [[nodiscard]] IPAddress getIP() const;
+  [[nodiscard]] uint32_t reconnectCount() const { return _reconnectCount; }
 
   void startApMode();
 
+  // Safe to call from the web server task; the attempt itself runs from
+  // update(). Returns the job id, or 0 while another job is still running.
+  uint32_t requestConnect(const String& ssid, const String& password);
+  [[nodiscard]] ConnectJob connectJob() const;
+  [[nodiscard]] uint32_t jobRevision() const { return _jobRevision; }
+  static const char* jobStateName(ConnectJobState state);
+
   struct ScannedNetwork {
     String ssid;
     int32_t rssi;
     bool open;
     bool saved;
   };
-  [[nodiscard]] std::vector<ScannedNetwork> getScannedNetworks() const;
+  using ScanList = TrackedVector<ScannedNetwork, HeapTag::WiFi>;
+  [[nodiscard]] ScanList getScannedNetworks() const;
 
  private:
   ConfigManager* _config = nullptr;
@@ -47,14 +76,46 @@ class WiFiManager {
   unsigned long _lastAction = 0;
   size_t _currentNetIndex = 0;
   bool _scanComplete = false;
+  uint32_t _reconnectCount = 0;
 
   struct MatchedNetwork {
     String ssid;
     String password;
     int32_t rssi;
   };
-  std::vector<MatchedNetwork> _matchedNetworks;
-  std::vector<ScannedNetwork> _allScannedNetworks;
+  TrackedVector<MatchedNetwork, HeapTag::WiFi> _matchedNetworks;
+  ScanList _allScannedNetworks;
+
+  // Only the radio side is cached. Addressing is left to DHCP: the lease
+  // the router granted is not known here, and reusing an address past it
+  // risks a conflict.
+  struct FastConnectCache {
+    uint32_t magic;
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+  };
+  FastConnectCache _fastCache{};
+  bool _fastCacheValid = false;
+  bool _fastPath = false;
+  unsigned long _connectStartMs = 0;
+
+  mutable std::mutex _jobLock;
+  ConnectJob _job;
+  uint32_t _nextJobId = 0;
+  std::atomic<uint32_t> _jobRevision{0};
+  bool _jobPending = false;
+  bool _jobActive = false;
+  bool _jobFromAp = false;
+  String _jobPassword;
+  unsigned long _apShutdownAtMs = 0;
+
+  bool _roamScanActive = false;
+  unsigned long _lastRoamScanMs = 0;
+
+  ConnectivityProbe _probe;
+  unsigned long _lastProbeMs = 0;
+  uint32_t _verifyAttempt = 0;
 
   DNSServer _dnsServer;
   static constexpr const char* AP_SSID = "TempMonitor-Setup";
@@ -65,14 +126,34 @@ class WiFiManager {
   static constexpr unsigned long CONNECT_TIMEOUT = 15000;
   static constexpr unsigned long VERIFY_TIMEOUT = 10000;
   static constexpr unsigned long RETRY_DELAY = 5000;
+  static constexpr unsigned long FAST_CONNECT_TIMEOUT = 4000;
+  static constexpr unsigned long AP_GRACE_MS = 15000;
+  static constexpr int32_t ROAM_TRIGGER_RSSI = -75;
+  static constexpr int32_t ROAM_HYSTERESIS_DB = 10;
+  // Passive scans run on a healthy link too, just less often than below
+  // ROAM_TRIGGER_RSSI; ROAM_HYSTERESIS_DB still gates the move.
+  static constexpr unsigned long ROAM_SCAN_INTERVAL = 60000;
+  static constexpr unsigned long ROAM_SCAN_HEALTHY_INTERVAL = 300000;
+  static constexpr uint32_t ROAM_SCAN_MS_PER_CHAN = 120;
+  static constexpr const char* FAST_CACHE_FILE = "/wifi_fast.bin";
 
-  static constexpr const char* CONNECTIVITY_CHECK_URL =
-      "http://connectivitycheck.gstatic.com/generate_204";
+  static constexpr unsigned long PROBE_INTERVAL = 2000;
+  static constexpr uint32_t PROBE_TIMEOUT_MS = 5000;
 
+  bool tryFastConnect();
+  void abandonFastPath();
+  void loadFastCache();
+  void saveFastCache();
+  void updateRoaming(unsigned long now);
+  void processRoamScan();
   void startScan();
   void processScanResults();
   void tryNextNetwork();
-  bool verifyInternet();
+  void beginVerifying(unsigned long now);
+  void onProbeResult(const ProbeOutcome& outcome);
+  void startPendingJob();
+  void setJobState(ConnectJobState state);
+  void failJob(const char* error);
   void onConnected();
   void onAllFailed();
 };
@@ -2,12 +2,14 @@
 
 #include "PinMap.h"
 
+#include <esp_timer.h>
 #include <mbedtls/sha256.h>
 #include <time.h>
 
 namespace {
 constexpr size_t PIN_MAX_LEN = 8;
 constexpr size_t PIN_MIN_LEN = 4;
+}  // namespace
 
 String hashPinSha256(const String& pin) {
   uint8_t hash[32];
@@ -34,7 +36,34 @@ bool isValidPinFormat(const String& pin) {
   }
   return true;
 }
-}  // namespace
+
+const char* accessResultName(AccessEventType type) {
+  switch (type) {
+    case AccessEventType::AccessGranted:
+      return "GRANTED";
+    case AccessEventType::AccessDenied:
+      return "DENIED";
+    case AccessEventType::LockoutStarted:
+      return "LOCKOUT";
+    case AccessEventType::LockoutEnded:
+      return "INFO";
+  }
+  return "UNKNOWN";
+}
+
+const char* accessReasonName(AccessEventType type) {
+  switch (type) {
+    case AccessEventType::AccessGranted:
+      return "VALID_PIN";
+    case AccessEventType::AccessDenied:
+      return "INVALID_PIN";
+    case AccessEventType::LockoutStarted:
+      return "MAX_FAILED_ATTEMPTS";
+    case AccessEventType::LockoutEnded:
+      return "LOCKOUT_ENDED";
+  }
+  return "UNKNOWN";
+}
 
 void AccessController::begin(ConfigManager* config) {
   _config = config;
@@ -64,16 +93,29 @@ void AccessController::begin(ConfigManager* config) {
 
   _keypad = std::make_unique<Keypad>(makeKeymap(keymap), rowPins, colPins,
                                      Pins::KEYPAD_ROWS, Pins::KEYPAD_COLS);
+  if (_scanTask == nullptr) {
+    xTaskCreatePinnedToCore(scanTask, "keypad", 2048, this, 2, &_scanTask, 1);
+  }
 }
 
-char AccessController::getKey() {
-  if (_keypad == nullptr) return NO_KEY;
-  return _keypad->getKey();
+void AccessController::scanTask(void* arg) {
+  auto* self = static_cast<AccessController*>(arg);
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    const char key = self->_keypad->getKey();
+    if (key != NO_KEY) self->_keyEvents.push({key, esp_timer_get_time()});
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(SCAN_PERIOD_MS));
+  }
+}
+
+bool AccessController::nextKey(KeyEvent& out) {
+  return _keyEvents.pop(out);
 }
 
-bool AccessController::upsertUser(const String& userId, const String& displayName,
-                                  const String& pin, bool enabled,
-                                  String& error) {
+bool AccessController::upsertUser(
+    const String& userId, const String& displayName, const String& pin,
+    bool enabled, String& error,
+    const ConfigManager::Precondition& precondition) {
   error = "";
   if (_config == nullptr) {
     error = "controller not initialized";
@@ -93,7 +135,7 @@ bool AccessController::upsertUser(const String& userId, const String& displayNam
   user.displayName = displayName.length() > 0 ? displayName : userId;
   user.pinHash = hashPinSha256(pin);
   user.enabled = enabled;
-  if (!_config->upsertUser(user)) {
+  if (!_config->upsertUser(user, precondition)) {
     error = "failed to save user";
     return false;
   }
@@ -105,13 +147,14 @@ AuthResult AccessController::validatePin(const String& pin) {
   if (_config == nullptr || !isValidPinFormat(pin)) return result;
 
   const String hash = hashPinSha256(pin);
-  for (const auto& user : _config->data.users) {
+  const ConfigSnapshot config = _config->read();
+  for (const auto& user : config->users) {
     if (!user.enabled || user.userId.length() == 0) continue;
     if (user.pinHash == hash) {
       result.success = true;
       result.userId = user.userId;
       result.displayName = user.displayName;
-      result.isAdmin = (user.userId == _config->data.users[0].userId);
+      result.isAdmin = (user.userId == config->users[0].userId);
 
       _failedAttempts = 0;
       _lastMessage = "ACCESS GRANTED";
@@ -119,11 +162,9 @@ AuthResult AccessController::validatePin(const String& pin) {
 
       AccessEvent event;
       event.type = AccessEventType::AccessGranted;
-      event.userId = user.userId;
-      event.displayName = user.displayName;
-      event.result = "GRANTED";
-      event.reason = "VALID_PIN";
-      event.failedCount = 0;
+      strlcpy(event.userId, user.userId.c_str(), sizeof(event.userId));
+      strlcpy(event.displayName, user.displayName.c_str(),
+              sizeof(event.displayName));
       pushEvent(event);
       return result;
     }
@@ -134,23 +175,19 @@ AuthResult AccessController::validatePin(const String& pin) {
 
   AccessEvent denied;
   denied.type = AccessEventType::AccessDenied;
-  denied.result = "DENIED";
-  denied.reason = "INVALID_PIN";
   denied.failedCount = _failedAttempts;
   pushEvent(denied);
 
-  if (_config != nullptr && _failedAttempts >= _config->data.maxFailedAttempts) {
-    _lockoutUntilMs = millis() + (_config->data.keypadLockoutSec * 1000UL);
+  if (_failedAttempts >= config->maxFailedAttempts) {
+    _lockoutUntilMs = millis() + (config->keypadLockoutSec * 1000UL);
     _failedAttempts = 0;
     _lastMessage = "LOCKOUT ACTIVE";
 
     AccessEvent lockout;
     lockout.type = AccessEventType::LockoutStarted;
-    lockout.result = "LOCKOUT";
-    lockout.reason = "MAX_FAILED_ATTEMPTS";
-    lockout.failedCount = _config->data.maxFailedAttempts;
+    lockout.failedCount = config->maxFailedAttempts;
     lockout.lockoutUntilEpoch = static_cast<uint32_t>(time(nullptr)) +
-                                _config->data.keypadLockoutSec;
+                                config->keypadLockoutSec;
     pushEvent(lockout);
   }
 
@@ -169,26 +206,32 @@ bool AccessController::changePin(const String& userId, const String& newPin,
     return false;
   }
 
-  for (auto& user : _config->data.users) {
-    if (user.userId == userId && user.enabled) {
-      user.pinHash = hashPinSha256(newPin);
-      if (_config->save()) return true;
-      error = "gagal menyimpan";
-      return false;
+  const String hash = hashPinSha256(newPin);
+  bool found = false;
+  const bool saved = _config->update([&](AppConfig& data) {
+    for (auto& user : data.users) {
+      if (user.userId == userId && user.enabled) {
+        user.pinHash = hash;
+        found = true;
+        return true;
+      }
     }
-  }
-  error = "user tidak ditemukan";
+    return false;
+  });
+  if (saved) return true;
+  error = found ? "gagal menyimpan" : "user tidak ditemukan";
   return false;
 }
 
 String AccessController::generateUserId() const {
   if (_config == nullptr) return "user01";
+  const ConfigSnapshot config = _config->read();
   for (int i = 1; i <= 99; ++i) {
     char buf[8];
     snprintf(buf, sizeof(buf), "user%02d", i);
     String candidate(buf);
     bool exists = false;
-    for (const auto& user : _config->data.users) {
+    for (const auto& user : config->users) {
       if (user.userId == candidate) {
         exists = true;
         break;
@@ -214,16 +257,10 @@ uint32_t AccessController::lockoutRemainingSec() const {
   return static_cast<uint32_t>((_lockoutUntilMs - millis()) / 1000UL);
 }
 
-void AccessController::pushEvent(const AccessEvent& event) {
-  _events.push_back(event);
-  if (_events.size() > 50) _events.pop_front();
-}
-
-bool AccessController::popEvent(AccessEvent& outEvent) {
-  if (_events.empty()) return false;
-  outEvent = _events.front();
-  _events.pop_front();
-  return true;
+void AccessController::pushEvent(AccessEvent event) {
+  event.epoch = static_cast<uint32_t>(time(nullptr));
+  event.atMs = millis();
+  _events.publish(event);
 }
 
 void AccessController::update() {
@@ -231,8 +268,6 @@ void AccessController::update() {
   if (_lockoutWasActive && !lockoutNow) {
     AccessEvent event;
     event.type = AccessEventType::LockoutEnded;
-    event.result = "INFO";
-    event.reason = "LOCKOUT_ENDED";
     event.failedCount = _failedAttempts;
     pushEvent(event);
     _lastMessage = "LOCKOUT ENDED";
@@ -0,0 +1,125 @@
+#include "Admission.h"
+
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+namespace {
+constexpr const char* VERDICT_NAMES[Admission::VERDICT_COUNT] = {
+    "admitted", "rate_limited", "busy", "low_heap",
+};
+
+// Tokens are kept in thousandths so refill needs no floating point.
+constexpr uint32_t TOKEN_SCALE = 1000;
+constexpr uint32_t REFILL_PER_SEC = 4;
+constexpr uint32_t BURST = 12;
+constexpr size_t MAX_CLIENTS = 8;
+constexpr uint32_t LOW_HEAP_RETRY_SEC = 2;
+constexpr uint32_t BUSY_RETRY_SEC = 1;
+
+struct Bucket {
+  uint32_t ip = 0;
+  uint32_t tokens = 0;
+  uint32_t refilledMs = 0;
+};
+
+portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+std::array<Bucket, MAX_CLIENTS> s_buckets{};
+uint32_t s_inFlight = 0;
+uint32_t s_inFlightHighWater = 0;
+std::atomic<uint32_t> s_verdicts[Admission::VERDICT_COUNT];
+
+// Oldest-refilled bucket is recycled when a new client shows up; a client
+// that lost its bucket simply starts again with a full burst.
+Bucket& bucketFor(uint32_t ip, uint32_t nowMs) {
+  Bucket* oldest = &s_buckets[0];
+  for (Bucket& bucket : s_buckets) {
+    if (bucket.ip == ip) return bucket;
+    if (bucket.ip == 0 ||
+        nowMs - bucket.refilledMs > nowMs - oldest->refilledMs) {
+      oldest = &bucket;
+    }
+  }
+  *oldest = {ip, BURST * TOKEN_SCALE, nowMs};
+  return *oldest;
+}
+
+void refill(Bucket& bucket, uint32_t nowMs) {
+  const uint32_t elapsedMs =
+      std::min(nowMs - bucket.refilledMs, BURST * TOKEN_SCALE / REFILL_PER_SEC);
+  const uint32_t gained = elapsedMs * REFILL_PER_SEC;
+  bucket.tokens = std::min(bucket.tokens + gained, BURST * TOKEN_SCALE);
+  bucket.refilledMs = nowMs;
+}
+
+AdmissionDecision decide(AdmissionVerdict verdict, uint32_t retryAfterSec) {
+  s_verdicts[static_cast<size_t>(verdict)].fetch_add(
+      1, std::memory_order_relaxed);
+  return {verdict, retryAfterSec};
+}
+}  // namespace
+
+namespace Admission {
+
+AdmissionDecision admit(uint32_t clientIp, uint8_t cost, bool holdsSlot) {
+  if (heap_caps_get_largest_free_block(MALLOC_CAP_8BIT) < MIN_FREE_BLOCK) {
+    return decide(AdmissionVerdict::LowHeap, LOW_HEAP_RETRY_SEC);
+  }
+
+  const uint32_t nowMs = millis();
+  const uint32_t needed = static_cast<uint32_t>(cost) * TOKEN_SCALE;
+  portENTER_CRITICAL(&s_lock);
+  Bucket& bucket = bucketFor(clientIp, nowMs);
+  refill(bucket, nowMs);
+  if (bucket.tokens < needed) {
+    const uint32_t missing = needed - bucket.tokens;
+    portEXIT_CRITICAL(&s_lock);
+    const uint32_t perSec = REFILL_PER_SEC * TOKEN_SCALE;
+    return decide(AdmissionVerdict::RateLimited,
+                  (missing + perSec - 1) / perSec);
+  }
+  if (holdsSlot && s_inFlight >= MAX_IN_FLIGHT) {
+    portEXIT_CRITICAL(&s_lock);
+    return decide(AdmissionVerdict::Busy, BUSY_RETRY_SEC);
+  }
+  bucket.tokens -= needed;
+  if (holdsSlot) {
+    ++s_inFlight;
+    s_inFlightHighWater = std::max(s_inFlightHighWater, s_inFlight);
+  }
+  portEXIT_CRITICAL(&s_lock);
+  return decide(AdmissionVerdict::Admitted, 0);
+}
+
+void release() {
+  portENTER_CRITICAL(&s_lock);
+  if (s_inFlight > 0) --s_inFlight;
+  portEXIT_CRITICAL(&s_lock);
+}
+
+AdmissionStats stats() {
+  AdmissionStats out;
+  portENTER_CRITICAL(&s_lock);
+  out.inFlight = s_inFlight;
+  out.inFlightHighWater = s_inFlightHighWater;
+  for (const Bucket& bucket : s_buckets) {
+    if (bucket.ip != 0) ++out.trackedClients;
+  }
+  portEXIT_CRITICAL(&s_lock);
+  return out;
+}
+
+uint32_t verdictCount(AdmissionVerdict verdict) {
+  const auto i = static_cast<size_t>(verdict);
+  return i < VERDICT_COUNT ? s_verdicts[i].load(std::memory_order_relaxed) : 0;
+}
+
+const char* verdictName(AdmissionVerdict verdict) {
+  const auto i = static_cast<size_t>(verdict);
+  return i < VERDICT_COUNT ? VERDICT_NAMES[i] : "unknown";
+}
+
+}  // namespace Admission
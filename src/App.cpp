@@ -1,12 +1,17 @@
 #include "App.h"
 
+#include "HeapTracker.h"
+#include "Metrics.h"
 #include "PinMap.h"
+#include "Profiler.h"
+#include "Trace.h"
 
 #include <Arduino.h>
 #include <ArduinoOTA.h>
 #include <ESPmDNS.h>
 #include <Wire.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <esp_task_wdt.h>
 
 namespace {
@@ -45,25 +50,45 @@ void App::setup() {
 
   Wire.begin(Pins::SDA, Pins::SCL);
 
-  if (!_config.begin()) Serial.println(F("Config init failed"));
-  _sensors.setReadIntervalMs(_config.data.sensorReadIntervalSec * 1000UL);
+  {
+    HeapTracker::Scope scope(HeapTag::Config);
+    if (!_config.begin()) Serial.println(F("Config init failed"));
+  }
+  _sensors.setReadIntervalMs(_config.read()->sensorReadIntervalSec * 1000UL);
 
-  if (_display.begin()) _display.showStartup();
+  {
+    HeapTracker::Scope scope(HeapTag::Display);
+    if (_display.begin()) _display.showStartup();
+  }
 
-  _sensors.begin();
+  {
+    HeapTracker::Scope scope(HeapTag::Sensors);
+    _sensors.begin();
+  }
   setupRelays();
-  _access.begin(&_config);
+  {
+    HeapTracker::Scope scope(HeapTag::Access);
+    _access.begin(&_config);
+  }
+  _displayEvents = _access.events().subscribe();
 
-  _wifi.begin(&_config);
+  {
+    HeapTracker::Scope scope(HeapTag::WiFi);
+    _wifi.begin(&_config);
+  }
   for (int i = 0; i < 20; ++i) {
     delay(100);
     yield();
   }
 
-  _network.begin(&_config, &_wifi, &_sensors, &_access);
+  {
+    HeapTracker::Scope scope(HeapTag::Network);
+    _network.begin(&_config, &_wifi, &_sensors, &_access);
+  }
 
   if (_wifi.isConnected()) setupOTA();
 
+  Profiler::begin();
   _display.clear();
 }
 
@@ -86,9 +111,12 @@ void App::setupOTA() {
 }
 
 void App::updateThermalAndFans(const SensorData& data) {
-  _warning = data.valid && (data.temperature > _config.data.warnThresholdC);
-  _fan2On = data.valid && (data.temperature >= _config.data.stage2ThresholdC);
-  _fan1On = _config.data.fan1BaselineOn || _warning || _fan2On;
+  const ConfigSnapshot config = _config.read();
+  _warning = data.valid &&
+             data.temperatureCenti > toCenti(config->warnThresholdC);
+  _fan2On = data.valid &&
+            data.temperatureCenti >= toCenti(config->stage2ThresholdC);
+  _fan1On = config->fan1BaselineOn || _warning || _fan2On;
 
   setRelay(Pins::RELAY_FAN1, _fan1On);
   setRelay(Pins::RELAY_FAN2, _fan2On);
@@ -96,8 +124,14 @@ void App::updateThermalAndFans(const SensorData& data) {
 
 void App::requestUnlock() {
   _solenoidOn = true;
-  _solenoidUnlockUntilMs = millis() + (_config.data.solenoidUnlockSec * 1000UL);
+  _solenoidUnlockUntilMs =
+      millis() + (_config.read()->solenoidUnlockSec * 1000UL);
   setRelay(Pins::RELAY_SOLENOID, true);
+  if (_lastKeyTsUs != 0) {
+    Metrics::observeUnlockLatency(
+        static_cast<uint32_t>(esp_timer_get_time() - _lastKeyTsUs));
+    _lastKeyTsUs = 0;
+  }
 }
 
 void App::updateSolenoid() {
@@ -111,10 +145,25 @@ void App::updateSolenoid() {
 
 void App::updateDisplay(const SensorData& data) {
   _display.setWifiInfo(_wifi.isConnected(), _wifi.getIP().toString());
-  _display.setTelemetry(data.temperature, data.humidity, data.valid, _fan1On,
-                        _fan2On, _warning);
-  _display.setSecurity(_solenoidOn ? "UNLOCKING" : "LOCKED", _access.lastMessage(),
-                       _access.isLockoutActive(), _access.lockoutRemainingSec());
+  _display.setTelemetry(data.temperatureCenti, data.humidityCenti, data.valid,
+                        _fan1On, _fan2On, _warning);
+  AccessEvent event;
+  while (_access.events().poll(_displayEvents, event)) {
+    if (event.type == AccessEventType::AccessGranted) {
+      snprintf(_accessBanner, sizeof(_accessBanner), "OK %s",
+               event.displayName);
+    } else if (event.type == AccessEventType::AccessDenied) {
+      snprintf(_accessBanner, sizeof(_accessBanner), "DENIED %u",
+               static_cast<unsigned>(event.failedCount));
+    } else if (event.type == AccessEventType::LockoutStarted) {
+      strlcpy(_accessBanner, "LOCKOUT ACTIVE", sizeof(_accessBanner));
+    } else {
+      strlcpy(_accessBanner, "LOCKOUT ENDED", sizeof(_accessBanner));
+    }
+  }
+  _display.setSecurity(_solenoidOn ? "UNLOCKING" : "LOCKED", _accessBanner,
+                       _access.isLockoutActive(),
+                       _access.lockoutRemainingSec());
 }
 
 void App::resetToMonitoring() {
@@ -127,9 +176,9 @@ void App::resetToMonitoring() {
 
 void App::buildUserSlotMap() {
   _userSlotCount = 0;
+  const ConfigSnapshot config = _config.read();
   for (size_t i = 0; i < MAX_USERS; ++i) {
-    if (_config.data.users[i].userId.length() == 0 ||
-        !_config.data.users[i].enabled)
+    if (config->users[i].userId.length() == 0 || !config->users[i].enabled)
       continue;
     if (_userListAction == 1 && i == 0) continue;
     if (_userSlotCount < MAX_SLOTS) {
@@ -214,7 +263,7 @@ void App::handleUIKey(char key) {
         _userListAction = 0;
         buildUserSlotMap();
         _uiState = UIState::USER_LIST;
-        _display.showUserList(_config.data.users, MAX_USERS, 0);
+        _display.showUserList(_config.read()->users.data(), MAX_USERS, 0);
       } else if (key == '3') {
         _autoUserId = _access.generateUserId();
         _pinBuf = "";
@@ -224,7 +273,7 @@ void App::handleUIKey(char key) {
         _userListAction = 1;
         buildUserSlotMap();
         _uiState = UIState::USER_LIST;
-        _display.showUserList(_config.data.users, MAX_USERS, 1);
+        _display.showUserList(_config.read()->users.data(), MAX_USERS, 1);
       }
       break;
     }
@@ -237,7 +286,7 @@ void App::handleUIKey(char key) {
         uint8_t slot = key - '1';
         if (slot < _userSlotCount) {
           uint8_t idx = _userSlotMap[slot];
-          _selectedUserId = _config.data.users[idx].userId;
+          _selectedUserId = _config.read()->users[idx].userId;
           if (_userListAction == 0) {
             _uiState = UIState::CHANGE_PIN;
             _changePinStep = 0;
@@ -329,7 +378,25 @@ void App::handleUIKey(char key) {
   }
 }
 
+void App::pollSerialCommand() {
+  while (Serial.available() > 0) {
+    const char c = static_cast<char>(Serial.read());
+    if (c != '\n' && c != '\r') {
+      if (_serialLine.length() < 32) _serialLine += c;
+      continue;
+    }
+    _serialLine.trim();
+    if (_serialLine == "heap") {
+      HeapTracker::printReport(Serial);
+    } else if (_serialLine.length() > 0) {
+      Serial.println(F("Commands: heap"));
+    }
+    _serialLine = "";
+  }
+}
+
 void App::loop() {
+  const unsigned long loopStartUs = micros();
   _wifi.update();
   _sensors.update();
   _access.update();
@@ -344,16 +411,15 @@ void App::loop() {
 
   if (_wifi.isConnected()) ArduinoOTA.handle();
 
-  AccessEvent event;
-  while (_access.popEvent(event)) {
-    _network.logAccessEvent(event);
-  }
-
   _network.update(data, _fan1On, _fan2On, _warning, _solenoidOn);
   updateDisplay(data);
 
-  char key = _access.getKey();
-  handleUIKey(key);
+  KeyEvent keyEvent;
+  while (_access.nextKey(keyEvent)) {
+    _lastKeyTsUs = keyEvent.tsUs;
+    handleUIKey(keyEvent.key);
+  }
+  pollSerialCommand();
 
   if (_uiState == UIState::MONITORING) {
     static unsigned long lastDisplayRefresh = 0;
@@ -373,5 +439,7 @@ void App::loop() {
     resetToMonitoring();
   }
 
+  TRACE_SLOW("App::loop", loopStartUs, LOOP_TRACE_MIN_US);
+  Metrics::observeLoop(micros() - loopStartUs);
   delay(1);
 }
@@ -0,0 +1,176 @@
+#include "AuditLog.h"
+
+#include <LittleFS.h>
+
+#include <algorithm>
+
+namespace {
+constexpr const char* USERS_FILE = "/audit/users.bin";
+}  // namespace
+
+bool AuditLog::begin() {
+  if (!_ring.begin(
+          [this](uint32_t segment) { resetSegmentBlocks(segment); },
+          [this](uint32_t seq, const AuditRecord& record) {
+            noteRecord(seq, record);
+          })) {
+    Serial.println(F("Audit log: cannot create /audit"));
+    return false;
+  }
+  _ring.locked([this]() {
+    loadUsers();
+    releaseUnusedUsers();
+  });
+  Serial.printf("Audit log: %lu records, %u users\n",
+                static_cast<unsigned long>(nextSeq() - firstSeq()),
+                static_cast<unsigned>(_userCount - 1));
+  return true;
+}
+
+void AuditLog::append(const AccessEvent& event) {
+  _ring.append(
+      [this, &event]() {
+        AuditRecord record;
+        record.epoch = event.epoch;
+        record.type = static_cast<uint8_t>(event.type);
+        record.userRef = event.userId[0] != '\0' ? userRef(event.userId) : 0;
+        record.failedCount = event.failedCount;
+        return record;
+      },
+      [this](uint32_t segment) {
+        resetSegmentBlocks(segment);
+        releaseUnusedUsers();
+      },
+      [this](uint32_t seq, const AuditRecord& record) {
+        noteRecord(seq, record);
+      });
+}
+
+AuditQuery AuditLog::makeQuery(uint32_t since, uint32_t until,
+                               const char* userId, uint32_t cursor) {
+  return _ring.locked([&]() {
+    AuditQuery query;
+    query.since = since;
+    query.until = until;
+    query.cursor = std::max(cursor, _ring.firstSeq());
+    query.endSeq = _ring.nextSeq();
+    if (userId != nullptr && userId[0] != '\0') {
+      query.userRef = findUser(userId);
+      if (query.userRef < 0) query.endSeq = query.cursor;
+    }
+    return query;
+  });
+}
+
+size_t AuditLog::read(AuditQuery& query, AuditEntry* out, size_t max) {
+  size_t count = 0;
+  return _ring.read(
+      query.cursor, query.endSeq, max,
+      [&](uint32_t cursor) {
+        while (cursor < query.endSeq &&
+               !blockMatches(cursor / BLOCK_RECORDS, query)) {
+          cursor = std::min<uint32_t>(
+              (cursor / BLOCK_RECORDS + 1) * BLOCK_RECORDS, query.endSeq);
+        }
+        return cursor;
+      },
+      [&](uint32_t seq, const AuditRecord& record) {
+        if (record.epoch < query.since || record.epoch > query.until) {
+          return false;
+        }
+        if (query.userRef >= 0 && record.userRef != query.userRef) {
+          return false;
+        }
+        out[count++] = {seq, record};
+        return true;
+      });
+}
+
+const char* AuditLog::userName(uint8_t ref) const {
+  return ref > 0 && ref < _userCount ? _users[ref].data() : "";
+}
+
+void AuditLog::loadUsers() {
+  _userCount = 1;
+  File file = LittleFS.open(USERS_FILE, "r");
+  if (!file) return;
+  while (_userCount < MAX_USERS &&
+         file.read(reinterpret_cast<uint8_t*>(_users[_userCount].data()),
+                   USER_ID_CAPACITY) == USER_ID_CAPACITY) {
+    _users[_userCount].back() = '\0';
+    ++_userCount;
+  }
+  file.close();
+}
+
+uint8_t AuditLog::userRef(const char* userId) {
+  const int16_t existing = findUser(userId);
+  if (existing >= 0) return static_cast<uint8_t>(existing);
+
+  uint8_t ref = 1;
+  while (ref < _userCount && _users[ref][0] != '\0') ++ref;
+  if (ref >= MAX_USERS) return 0;
+
+  _users[ref].fill('\0');
+  strlcpy(_users[ref].data(), userId, USER_ID_CAPACITY);
+  if (!storeUser(ref)) {
+    _users[ref].fill('\0');
+    return 0;
+  }
+  if (ref == _userCount) ++_userCount;
+  return ref;
+}
+
+// Slot i of users.bin holds ref i + 1; ref 0 means "no user".
+bool AuditLog::storeUser(uint8_t ref) {
+  const bool appending = ref == _userCount;
+  File file = LittleFS.open(USERS_FILE, appending ? "a" : "r+");
+  const bool ok =
+      file && (appending || file.seek((ref - 1) * USER_ID_CAPACITY)) &&
+      file.write(reinterpret_cast<const uint8_t*>(_users[ref].data()),
+                 USER_ID_CAPACITY) == USER_ID_CAPACITY;
+  file.close();
+  if (!ok) ++_userWriteErrors;
+  return ok;
+}
+
+// Frees the slots of users no kept block mentions any more, so refs are
+// recycled as old segments drop out instead of running out for good.
+void AuditLog::releaseUnusedUsers() {
+  uint32_t liveMask = 0;
+  for (const BlockIndex& block : _blocks) liveMask |= block.userMask;
+  for (uint8_t ref = 1; ref < _userCount; ++ref) {
+    if (_users[ref][0] == '\0' || (liveMask & (1UL << ref)) != 0) continue;
+    _users[ref].fill('\0');
+    storeUser(ref);
+  }
+}
+
+int16_t AuditLog::findUser(const char* userId) const {
+  for (uint8_t i = 1; i < _userCount; ++i) {
+    if (_users[i][0] == '\0') continue;
+    if (strncmp(_users[i].data(), userId, USER_ID_CAPACITY) == 0) return i;
+  }
+  return -1;
+}
+
+void AuditLog::noteRecord(uint32_t seq, const AuditRecord& record) {
+  BlockIndex& block = _blocks[(seq / BLOCK_RECORDS) % BLOCK_COUNT];
+  block.minEpoch = std::min(block.minEpoch, record.epoch);
+  block.maxEpoch = std::max(block.maxEpoch, record.epoch);
+  block.userMask |= 1UL << (record.userRef % 32);
+}
+
+void AuditLog::resetSegmentBlocks(uint32_t segment) {
+  const size_t first = (segment * BLOCKS_PER_SEGMENT) % BLOCK_COUNT;
+  for (size_t i = 0; i < BLOCKS_PER_SEGMENT; ++i) _blocks[first + i] = {};
+}
+
+bool AuditLog::blockMatches(uint32_t block, const AuditQuery& query) const {
+  const BlockIndex& index = _blocks[block % BLOCK_COUNT];
+  if (index.minEpoch > query.until || index.maxEpoch < query.since) {
+    return false;
+  }
+  return query.userRef < 0 ||
+         (index.userMask & (1UL << (query.userRef % 32))) != 0;
+}
@@ -1,25 +1,37 @@
 #include "Config.h"
 
+#include "ConfigSchema.h"
+#include "HeapTracker.h"
+#include "Trace.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
 namespace {
 constexpr const char* DEFAULT_ADMIN_HASH =
     "03ac674216f3e15c761ee1a5e255f067953623c8b388b4459e13f978d7c846f4";  // 1234
-constexpr const char* DEFAULT_DEVICE_ID = "esp32-smart-server-01";
-constexpr const char* DEFAULT_GSCRIPT_URL =
-    "https://script.google.com/macros/s/AKfycbxVuisohtU0X2y6SBJhpR7stwr54dERGWv8wgq9KsjWhxZb-eH541N9pq33luIBhrWH4g/exec";
 
 bool isStrictSchemaValid(const JsonDocument& doc) {
   return doc[ConfigKeys::WIFI_NETWORKS].is<JsonArray>() &&
          doc[ConfigKeys::USERS].is<JsonArray>() &&
-         doc[ConfigKeys::SENSOR_INTERVAL].is<uint32_t>() &&
-         doc[ConfigKeys::CLOUD_INTERVAL].is<uint32_t>() &&
-         doc[ConfigKeys::WARN_THRESHOLD].is<float>() &&
-         doc[ConfigKeys::STAGE2_THRESHOLD].is<float>() &&
-         doc[ConfigKeys::FAN1_BASELINE].is<bool>() &&
-         doc[ConfigKeys::MAX_FAILED].is<uint8_t>() &&
-         doc[ConfigKeys::KEYPAD_LOCKOUT].is<uint32_t>() &&
-         doc[ConfigKeys::SOLENOID_UNLOCK].is<uint32_t>() &&
-         doc[ConfigKeys::GOOGLE_SCRIPT_URL].is<const char*>() &&
-         doc[ConfigKeys::DEVICE_ID].is<const char*>();
+         ConfigSchema::validate(doc.as<JsonVariantConst>());
+}
+
+size_t countUsers(const AppConfig& config) {
+  size_t count = 0;
+  for (const auto& user : config.users) {
+    if (user.userId.length() > 0 && user.enabled) ++count;
+  }
+  return count;
+}
+
+UserCredential* userSlot(AppConfig& data, const String& userId) {
+  UserCredential* empty = nullptr;
+  for (auto& user : data.users) {
+    if (user.userId == userId) return &user;
+    if (empty == nullptr && user.userId.length() == 0) empty = &user;
+  }
+  return empty;
 }
 }  // namespace
 
@@ -42,16 +54,7 @@ AppConfig::AppConfig() {
   users[0].pinHash = DEFAULT_ADMIN_HASH;
   users[0].enabled = true;
 
-  sensorReadIntervalSec = 5;
-  cloudSendIntervalSec = 60;
-  warnThresholdC = 27.0f;
-  stage2ThresholdC = 28.0f;
-  fan1BaselineOn = true;
-  maxFailedAttempts = 3;
-  keypadLockoutSec = 120;
-  solenoidUnlockSec = 10;
-  googleScriptUrl = DEFAULT_GSCRIPT_URL;
-  deviceId = DEFAULT_DEVICE_ID;
+  ConfigSchema::applyDefaults(*this);
 }
 
 ConfigManager::ConfigManager(const char* filename) : _filename(filename) {}
@@ -64,9 +67,44 @@ bool ConfigManager::begin() {
   return load();
 }
 
+ConfigSnapshot ConfigManager::read() const {
+  for (;;) {
+    const uint8_t slot = _active.load();
+    _readers[slot].fetch_add(1);
+    // A writer may have swapped between the two loads; only a pin taken on
+    // the still-active slot is safe from being overwritten.
+    if (_active.load() == slot) {
+      return ConfigSnapshot(&_readers[slot], &_slots[slot]);
+    }
+    _readers[slot].fetch_sub(1);
+  }
+}
+
+bool ConfigManager::update(const Mutator& mutate) {
+  return commit(mutate, true);
+}
+
+bool ConfigManager::commit(const Mutator& mutate, bool persist) {
+  std::lock_guard<std::mutex> guard(_writeLock);
+  const uint8_t current = _active.load();
+  const uint8_t spare = current ^ 1;
+  while (_readers[spare].load() != 0) vTaskDelay(1);
+
+  _slots[spare] = _slots[current];
+  if (!mutate(_slots[spare])) return false;
+  if (persist) _slots[spare].version = _slots[current].version + 1;
+  _active.store(spare);
+  return !persist || save(_slots[spare]);
+}
+
 bool ConfigManager::resetToDefaultsAndSave() {
-  data = AppConfig();
-  return save();
+  return update([](AppConfig& config) {
+    // Keep counting up so a reset never hands out an ETag seen before it.
+    const uint32_t version = config.version;
+    config = AppConfig();
+    config.version = version;
+    return true;
+  });
 }
 
 bool ConfigManager::load() {
@@ -76,7 +114,7 @@ bool ConfigManager::load() {
     return resetToDefaultsAndSave();
   }
 
-  JsonDocument doc;
+  JsonDocument doc(HeapTracker::jsonAllocator(HeapTag::Config));
   DeserializationError err = deserializeJson(doc, file);
   file.close();
 
@@ -90,47 +128,47 @@ bool ConfigManager::load() {
     return resetToDefaultsAndSave();
   }
 
-  for (auto& network : data.wifiNetworks) {
-    network = WiFiCredential{};
-    network.enabled = false;
-  }
-  for (auto& user : data.users) {
-    user = UserCredential{};
-    user.enabled = false;
-  }
-
-  size_t i = 0;
-  for (JsonObject net : doc[ConfigKeys::WIFI_NETWORKS].as<JsonArray>()) {
-    if (i >= MAX_WIFI_NETWORKS) break;
-    data.wifiNetworks[i].ssid = net[ConfigKeys::SSID].as<String>();
-    data.wifiNetworks[i].password = net[ConfigKeys::PASSWORD].as<String>();
-    data.wifiNetworks[i].enabled = net[ConfigKeys::ENABLED] | true;
-    ++i;
-  }
-
-  i = 0;
-  for (JsonObject user : doc[ConfigKeys::USERS].as<JsonArray>()) {
-    if (i >= MAX_USERS) break;
-    data.users[i].userId = user[ConfigKeys::USER_ID].as<String>();
-    data.users[i].displayName = user[ConfigKeys::DISPLAY_NAME].as<String>();
-    data.users[i].pinHash = user[ConfigKeys::PIN_HASH].as<String>();
-    data.users[i].enabled = user[ConfigKeys::ENABLED] | true;
-    ++i;
-  }
-
-  data.sensorReadIntervalSec = doc[ConfigKeys::SENSOR_INTERVAL].as<uint32_t>();
-  data.cloudSendIntervalSec = doc[ConfigKeys::CLOUD_INTERVAL].as<uint32_t>();
-  data.warnThresholdC = doc[ConfigKeys::WARN_THRESHOLD].as<float>();
-  data.stage2ThresholdC = doc[ConfigKeys::STAGE2_THRESHOLD].as<float>();
-  data.fan1BaselineOn = doc[ConfigKeys::FAN1_BASELINE].as<bool>();
-  data.maxFailedAttempts = doc[ConfigKeys::MAX_FAILED].as<uint8_t>();
-  data.keypadLockoutSec = doc[ConfigKeys::KEYPAD_LOCKOUT].as<uint32_t>();
-  data.solenoidUnlockSec = doc[ConfigKeys::SOLENOID_UNLOCK].as<uint32_t>();
-  data.googleScriptUrl = doc[ConfigKeys::GOOGLE_SCRIPT_URL].as<String>();
-  data.deviceId = doc[ConfigKeys::DEVICE_ID].as<String>();
-
-  if (data.googleScriptUrl.length() == 0 || data.deviceId.length() == 0 ||
-      getUserCount() == 0) {
+  const bool complete = commit(
+      [&doc](AppConfig& data) {
+        for (auto& network : data.wifiNetworks) {
+          network = WiFiCredential{};
+          network.enabled = false;
+        }
+        for (auto& user : data.users) {
+          user = UserCredential{};
+          user.enabled = false;
+        }
+
+        size_t i = 0;
+        for (JsonObject net : doc[ConfigKeys::WIFI_NETWORKS].as<JsonArray>()) {
+          if (i >= MAX_WIFI_NETWORKS) break;
+          data.wifiNetworks[i].ssid = net[ConfigKeys::SSID].as<String>();
+          data.wifiNetworks[i].password =
+              net[ConfigKeys::PASSWORD].as<String>();
+          data.wifiNetworks[i].enabled = net[ConfigKeys::ENABLED] | true;
+          ++i;
+        }
+
+        i = 0;
+        for (JsonObject user : doc[ConfigKeys::USERS].as<JsonArray>()) {
+          if (i >= MAX_USERS) break;
+          data.users[i].userId = user[ConfigKeys::USER_ID].as<String>();
+          data.users[i].displayName =
+              user[ConfigKeys::DISPLAY_NAME].as<String>();
+          data.users[i].pinHash = user[ConfigKeys::PIN_HASH].as<String>();
+          data.users[i].enabled = user[ConfigKeys::ENABLED] | true;
+          ++i;
+        }
+
+        ConfigSchema::load(doc.as<JsonVariantConst>(), data);
+        data.version = doc[ConfigKeys::VERSION].as<uint32_t>();
+
+        return data.googleScriptUrl.length() > 0 &&
+               data.deviceId.length() > 0 && countUsers(data) > 0;
+      },
+      false);
+
+  if (!complete) {
     Serial.println(F("Config incomplete. Resetting defaults."));
     return resetToDefaultsAndSave();
   }
@@ -139,8 +177,9 @@ bool ConfigManager::load() {
   return true;
 }
 
-bool ConfigManager::save() {
-  JsonDocument doc;
+bool ConfigManager::save(const AppConfig& data) {
+  TRACE_SCOPE("ConfigManager::save");
+  JsonDocument doc(HeapTracker::jsonAllocator(HeapTag::Config));
 
   JsonArray wifiArr = doc[ConfigKeys::WIFI_NETWORKS].to<JsonArray>();
   for (const auto& network : data.wifiNetworks) {
@@ -161,16 +200,8 @@ bool ConfigManager::save() {
     item[ConfigKeys::ENABLED] = user.enabled;
   }
 
-  doc[ConfigKeys::SENSOR_INTERVAL] = data.sensorReadIntervalSec;
-  doc[ConfigKeys::CLOUD_INTERVAL] = data.cloudSendIntervalSec;
-  doc[ConfigKeys::WARN_THRESHOLD] = data.warnThresholdC;
-  doc[ConfigKeys::STAGE2_THRESHOLD] = data.stage2ThresholdC;
-  doc[ConfigKeys::FAN1_BASELINE] = data.fan1BaselineOn;
-  doc[ConfigKeys::MAX_FAILED] = data.maxFailedAttempts;
-  doc[ConfigKeys::KEYPAD_LOCKOUT] = data.keypadLockoutSec;
-  doc[ConfigKeys::SOLENOID_UNLOCK] = data.solenoidUnlockSec;
-  doc[ConfigKeys::GOOGLE_SCRIPT_URL] = data.googleScriptUrl;
-  doc[ConfigKeys::DEVICE_ID] = data.deviceId;
+  ConfigSchema::save(data, doc.as<JsonVariant>());
+  doc[ConfigKeys::VERSION] = data.version;
 
   File file = LittleFS.open(_filename, "w");
   if (!file) {
@@ -184,99 +215,127 @@ bool ConfigManager::save() {
 }
 
 bool ConfigManager::addWiFi(const String& ssid, const String& password) {
-  for (auto& network : data.wifiNetworks) {
-    if (network.ssid == ssid) {
-      network.password = password;
-      network.enabled = true;
-      return save();
+  return update([&](AppConfig& data) {
+    for (auto& network : data.wifiNetworks) {
+      if (network.ssid == ssid) {
+        network.password = password;
+        network.enabled = true;
+        return true;
+      }
     }
-  }
 
-  for (auto& network : data.wifiNetworks) {
-    if (network.ssid.length() == 0) {
-      network.ssid = ssid;
-      network.password = password;
-      network.enabled = true;
-      return save();
+    for (auto& network : data.wifiNetworks) {
+      if (network.ssid.length() == 0) {
+        network.ssid = ssid;
+        network.password = password;
+        network.enabled = true;
+        return true;
+      }
     }
-  }
-  return false;
+    return false;
+  });
 }
 
 bool ConfigManager::removeWiFi(const String& ssid) {
-  for (auto& network : data.wifiNetworks) {
-    if (network.ssid == ssid) {
-      network.ssid = "";
-      network.password = "";
-      network.enabled = false;
-      return save();
+  return update([&](AppConfig& data) {
+    for (auto& network : data.wifiNetworks) {
+      if (network.ssid == ssid) {
+        network.ssid = "";
+        network.password = "";
+        network.enabled = false;
+        return true;
+      }
     }
-  }
-  return false;
+    return false;
+  });
 }
 
 size_t ConfigManager::getWiFiCount() const {
+  const ConfigSnapshot config = read();
   size_t count = 0;
-  for (const auto& network : data.wifiNetworks) {
+  for (const auto& network : config->wifiNetworks) {
     if (network.ssid.length() > 0 && network.enabled) ++count;
   }
   return count;
 }
 
 void ConfigManager::clearAllWiFi() {
-  for (auto& network : data.wifiNetworks) {
-    network.ssid = "";
-    network.password = "";
-    network.enabled = false;
-  }
-  save();
+  update([](AppConfig& data) {
+    for (auto& network : data.wifiNetworks) {
+      network.ssid = "";
+      network.password = "";
+      network.enabled = false;
+    }
+    return true;
+  });
 }
 
-bool ConfigManager::upsertUser(const UserCredential& user) {
+bool ConfigManager::upsertUser(const UserCredential& user,
+                               const Precondition& precondition) {
   if (user.userId.length() == 0 || user.pinHash.length() == 0) return false;
 
-  for (auto& existing : data.users) {
-    if (existing.userId == user.userId) {
-      existing.displayName = user.displayName;
-      existing.pinHash = user.pinHash;
-      existing.enabled = user.enabled;
-      return save();
-    }
-  }
+  return update([&](AppConfig& data) {
+    if (precondition && !precondition(data)) return false;
+    UserCredential* slot = userSlot(data, user.userId);
+    if (slot == nullptr) return false;
+    *slot = user;
+    return true;
+  });
+}
 
-  for (auto& existing : data.users) {
-    if (existing.userId.length() == 0) {
-      existing = user;
-      return save();
+bool ConfigManager::upsertUsers(const UserCredential* users, size_t count,
+                                size_t& created, size_t& failed,
+                                const Precondition& precondition) {
+  created = 0;
+  failed = count;
+  return update([&](AppConfig& data) {
+    if (precondition && !precondition(data)) return false;
+    created = 0;
+    for (size_t i = 0; i < count; ++i) {
+      const UserCredential& user = users[i];
+      UserCredential* slot = userSlot(data, user.userId);
+      const bool isNew = slot != nullptr && slot->userId.length() == 0;
+      if (slot == nullptr || (isNew && user.pinHash.length() == 0)) {
+        failed = i;
+        return false;
+      }
+      const String pinHash =
+          user.pinHash.length() > 0 ? user.pinHash : slot->pinHash;
+      *slot = user;
+      slot->pinHash = pinHash;
+      if (isNew) ++created;
     }
-  }
-  return false;
+    return true;
+  });
 }
 
-bool ConfigManager::removeUser(const String& userId) {
-  for (auto& user : data.users) {
-    if (user.userId == userId) {
-      user.userId = "";
-      user.displayName = "";
-      user.pinHash = "";
-      user.enabled = false;
-      return save();
+bool ConfigManager::removeUser(const String& userId,
+                               const Precondition& precondition) {
+  return update([&](AppConfig& data) {
+    if (precondition && !precondition(data)) return false;
+    for (auto& user : data.users) {
+      if (user.userId == userId) {
+        user.userId = "";
+        user.displayName = "";
+        user.pinHash = "";
+        user.enabled = false;
+        return true;
+      }
     }
-  }
-  return false;
+    return false;
+  });
 }
 
-size_t ConfigManager::getUserCount() const {
-  size_t count = 0;
-  for (const auto& user : data.users) {
-    if (user.userId.length() > 0 && user.enabled) ++count;
-  }
-  return count;
-}
+size_t ConfigManager::getUserCount() const { return countUsers(*read()); }
 
-const UserCredential* ConfigManager::findUser(const String& userId) const {
-  for (const auto& user : data.users) {
-    if (user.userId == userId && user.enabled) return &user;
+bool ConfigManager::findUser(const String& userId,
+                             UserCredential& out) const {
+  const ConfigSnapshot config = read();
+  for (const auto& user : config->users) {
+    if (user.userId == userId && user.enabled) {
+      out = user;
+      return true;
+    }
   }
-  return nullptr;
+  return false;
 }
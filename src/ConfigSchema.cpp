@@ -0,0 +1,163 @@
+#include "ConfigSchema.h"
+
+#include <algorithm>
+
+namespace {
+constexpr const char* GROUP_NAMES[] = {"internal", "thermal", "security"};
+
+template <typename Fn>
+void forEachField(Fn&& fn) {
+  std::apply([&fn](const auto&... field) { (fn(field), ...); },
+             ConfigSchema::FIELDS);
+}
+
+template <typename T>
+constexpr const char* typeName() {
+  if constexpr (std::is_same_v<T, bool>) {
+    return "bool";
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return "float";
+  } else {
+    return "int";
+  }
+}
+
+bool textOk(const ConfigTextField& field, const char* value) {
+  if (value == nullptr) return false;
+  const size_t len = strlen(value);
+  if (len == 0 || len > field.maxLen) return false;
+  return field.accept == nullptr || field.accept(value);
+}
+
+template <typename T>
+void applyDefault(const ConfigField<T>& field, AppConfig& config) {
+  config.*field.member = field.fallback;
+}
+
+void applyDefault(const ConfigTextField& field, AppConfig& config) {
+  config.*field.member = field.fallback;
+}
+
+// A missing key loads its fallback, so a config saved before a row was added
+// still loads; only a key of the wrong type invalidates the file.
+template <typename T>
+bool valid(const ConfigField<T>& field, JsonVariantConst doc) {
+  JsonVariantConst value = doc[field.key];
+  return value.isNull() || value.template is<T>();
+}
+
+bool valid(const ConfigTextField& field, JsonVariantConst doc) {
+  JsonVariantConst value = doc[field.key];
+  if (value.isNull()) return !field.required;
+  return value.is<const char*>() && textOk(field, value.as<const char*>());
+}
+
+template <typename T>
+void loadField(const ConfigField<T>& field, JsonVariantConst doc,
+               AppConfig& config) {
+  JsonVariantConst value = doc[field.key];
+  const T loaded = value.isNull() ? field.fallback : value.template as<T>();
+  config.*field.member = std::clamp(loaded, field.min, field.max);
+}
+
+void loadField(const ConfigTextField& field, JsonVariantConst doc,
+               AppConfig& config) {
+  config.*field.member = doc[field.key] | field.fallback;
+}
+
+template <typename Field>
+void saveField(const Field& field, const AppConfig& config, JsonVariant doc) {
+  doc[field.key] = config.*field.member;
+}
+
+template <typename T>
+bool applyApi(const ConfigField<T>& field, JsonVariantConst value,
+              AppConfig& config) {
+  if (!value.is<T>()) return false;
+  const T parsed = value.as<T>();
+  if (parsed < field.min || parsed > field.max) return false;
+  config.*field.member = parsed;
+  return true;
+}
+
+bool applyApi(const ConfigTextField& field, JsonVariantConst value,
+              AppConfig& config) {
+  if (!value.is<const char*>()) return false;
+  const char* text = value.as<const char*>();
+  if (!textOk(field, text)) return false;
+  config.*field.member = text;
+  return true;
+}
+
+template <typename T>
+void describeField(const ConfigField<T>& field, JsonObject item) {
+  item["type"] = typeName<T>();
+  if constexpr (!std::is_same_v<T, bool>) {
+    item["min"] = field.min;
+    item["max"] = field.max;
+  }
+}
+
+void describeField(const ConfigTextField& field, JsonObject item) {
+  item["type"] = "text";
+  item["maxLen"] = field.maxLen;
+}
+}  // namespace
+
+namespace ConfigSchema {
+
+bool acceptHttpUrl(const char* value) {
+  return strncmp(value, "http://", 7) == 0 ||
+         strncmp(value, "https://", 8) == 0;
+}
+
+void applyDefaults(AppConfig& config) {
+  forEachField([&config](const auto& field) { applyDefault(field, config); });
+}
+
+bool validate(JsonVariantConst doc) {
+  bool ok = true;
+  forEachField([&](const auto& field) { ok = ok && valid(field, doc); });
+  return ok;
+}
+
+void load(JsonVariantConst doc, AppConfig& config) {
+  forEachField([&](const auto& field) { loadField(field, doc, config); });
+}
+
+void save(const AppConfig& config, JsonVariant doc) {
+  forEachField([&](const auto& field) { saveField(field, config, doc); });
+}
+
+void toApi(const AppConfig& config, ConfigGroup group, JsonObject out) {
+  forEachField([&](const auto& field) {
+    if (field.group == group) out[field.api] = config.*field.member;
+  });
+}
+
+const char* fromApi(JsonObjectConst in, ConfigGroup group,
+                    AppConfig& config) {
+  const char* rejected = nullptr;
+  forEachField([&](const auto& field) {
+    if (rejected != nullptr || field.group != group) return;
+    JsonVariantConst value = in[field.api];
+    if (value.isNull()) return;
+    if (!applyApi(field, value, config)) rejected = field.api;
+  });
+  return rejected;
+}
+
+void describe(JsonObject out) {
+  forEachField([&](const auto& field) {
+    if (field.group == ConfigGroup::Internal) return;
+    JsonVariant slot = out[GROUP_NAMES[static_cast<size_t>(field.group)]];
+    JsonArray fields = slot.is<JsonArray>() ? slot.as<JsonArray>()
+                                            : slot.to<JsonArray>();
+    JsonObject item = fields.add<JsonObject>();
+    item["name"] = field.api;
+    item["label"] = field.label;
+    describeField(field, item);
+  });
+}
+
+}  // namespace ConfigSchema
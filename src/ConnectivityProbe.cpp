@@ -0,0 +1,59 @@
+#include "ConnectivityProbe.h"
+
+#include <HTTPClient.h>
+
+void ConnectivityProbe::begin(Callback onResult) {
+  _onResult = std::move(onResult);
+  if (_task != nullptr) return;
+  xTaskCreatePinnedToCore(taskEntry, "netprobe", TASK_STACK, this, 1, &_task,
+                          0);
+}
+
+bool ConnectivityProbe::start(const String& url, uint32_t timeoutMs,
+                              uint32_t attempt) {
+  if (_task == nullptr || _phase != Phase::Idle) return false;
+  if (url.length() == 0 || url.length() >= URL_CAPACITY) return false;
+
+  memcpy(_url, url.c_str(), url.length() + 1);
+  _timeoutMs = min<uint32_t>(timeoutMs, UINT16_MAX);
+  _attempt = attempt;
+  _phase = Phase::Running;
+  xTaskNotifyGive(_task);
+  return true;
+}
+
+void ConnectivityProbe::poll() {
+  if (_phase != Phase::Done) return;
+
+  _last.attempt = _attempt;
+  _last.httpCode = _httpCode;
+  _last.durationMs = _durationMs;
+  _last.online = _httpCode == 204;
+  _phase = Phase::Idle;
+  if (_onResult) _onResult(_last);
+}
+
+void ConnectivityProbe::taskEntry(void* arg) {
+  static_cast<ConnectivityProbe*>(arg)->run();
+}
+
+void ConnectivityProbe::run() {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (_phase != Phase::Running) continue;
+
+    const unsigned long startMs = millis();
+    HTTPClient http;
+    http.setConnectTimeout(_timeoutMs);
+    http.setTimeout(static_cast<uint16_t>(_timeoutMs));
+    int code = -1;
+    if (http.begin(_url)) {
+      code = http.GET();
+      http.end();
+    }
+
+    _httpCode = code;
+    _durationMs = millis() - startMs;
+    _phase = Phase::Done;
+  }
+}
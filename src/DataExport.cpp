@@ -0,0 +1,318 @@
+#include "DataExport.h"
+
+#include "FixedPoint.h"
+
+#include <algorithm>
+
+namespace {
+constexpr size_t READ_BATCH = 16;
+constexpr size_t CSV_BATCH = 12;
+constexpr size_t BINARY_HEADER_SIZE = 8;
+
+constexpr size_t padded(size_t bytes) { return (bytes + 3) & ~size_t{3}; }
+
+void putLe(uint8_t* out, uint8_t size, uint32_t value) {
+  for (uint8_t i = 0; i < size; ++i) out[i] = (value >> (8 * i)) & 0xFF;
+}
+
+size_t clampLen(int len, size_t cap) {
+  return cap == 0 ? 0 : std::min<size_t>(std::max(len, 0), cap - 1);
+}
+
+constexpr DataExport::Column TELEMETRY_COLUMNS[] = {
+    {"epoch", "u32", 4, 0},
+    {"temperature", "i16", 2, -2},
+    {"humidity", "u16", 2, -2},
+    {"flags", "u8", 1, 0},
+};
+
+constexpr DataExport::Column ACCESS_COLUMNS[] = {
+    {"seq", "u32", 4, 0},
+    {"epoch", "u32", 4, 0},
+    {"type", "u8", 1, 0},
+    {"user", "u8", 1, 0},
+    {"failed", "u8", 1, 0},
+};
+
+template <size_t N>
+constexpr size_t blockBytes(const DataExport::Column (&columns)[N]) {
+  size_t bytes = 4;
+  for (const auto& column : columns) {
+    bytes += padded(DataExport::BLOCK_ROWS * column.size);
+  }
+  return bytes;
+}
+
+static_assert(blockBytes(TELEMETRY_COLUMNS) <= DataExport::BUFFER_SIZE &&
+                  blockBytes(ACCESS_COLUMNS) <= DataExport::BUFFER_SIZE,
+              "a full block must fit the export buffer");
+static_assert(std::size(ACCESS_COLUMNS) <= DataExport::MAX_COLUMNS,
+              "RowValues too narrow");
+}  // namespace
+
+size_t copyJsonString(char* out, size_t cap, const char* value) {
+  size_t len = 0;
+  for (; *value != '\0' && len + 2 < cap; ++value) {
+    const char c = *value;
+    if (static_cast<unsigned char>(c) < 0x20) continue;
+    if (c == '"' || c == '\\') out[len++] = '\\';
+    out[len++] = c;
+  }
+  out[len] = '\0';
+  return len;
+}
+
+size_t copyCsvField(char* out, size_t cap, const char* value) {
+  if (strpbrk(value, ",\"") == nullptr) {
+    return static_cast<size_t>(snprintf(out, cap, "%s", value));
+  }
+  size_t len = 0;
+  out[len++] = '"';
+  for (; *value != '\0' && len + 3 < cap; ++value) {
+    if (*value == '"') out[len++] = '"';
+    out[len++] = *value;
+  }
+  out[len++] = '"';
+  out[len] = '\0';
+  return len;
+}
+
+DataExport::DataExport(ExportKind kind, ExportFormat format, uint32_t from,
+                       uint32_t to, SensorHistory& history, AuditLog& audit)
+    : _kind(kind), _format(format), _history(history), _audit(audit) {
+  if (kind == ExportKind::Telemetry) {
+    _sensorQuery = history.makeQuery(from, to);
+  } else {
+    _auditQuery = audit.makeQuery(from, to, nullptr, 0);
+  }
+}
+
+bool DataExport::parseKind(const String& text, ExportKind& out) {
+  if (text == "telemetry") {
+    out = ExportKind::Telemetry;
+  } else if (text == "access") {
+    out = ExportKind::Access;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool DataExport::parseFormat(const String& text, ExportFormat& out) {
+  if (text == "csv") {
+    out = ExportFormat::Csv;
+  } else if (text == "bin") {
+    out = ExportFormat::Binary;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* DataExport::kindName(ExportKind kind) {
+  return kind == ExportKind::Telemetry ? "telemetry" : "access";
+}
+
+size_t DataExport::fill(uint8_t* buf, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (_pos == _len) {
+      _pos = 0;
+      _len = 0;
+      if (!refill()) break;
+    }
+    const size_t n = std::min(maxLen - written, _len - _pos);
+    memcpy(buf + written, _buf + _pos, n);
+    _pos += n;
+    written += n;
+  }
+  return written;
+}
+
+bool DataExport::refill() {
+  switch (_phase) {
+    case Phase::Header:
+      writeHeader();
+      _phase = Phase::Rows;
+      return true;
+    case Phase::Rows:
+      if (_format == ExportFormat::Binary) {
+        if (!writeBlock()) _phase = Phase::Done;
+        return true;
+      }
+      if (writeCsvRows()) return true;
+      _phase = Phase::Done;
+      return false;
+    case Phase::Done:
+      return false;
+  }
+  return false;
+}
+
+const DataExport::Column* DataExport::columns(size_t& count) const {
+  if (_kind == ExportKind::Telemetry) {
+    count = std::size(TELEMETRY_COLUMNS);
+    return TELEMETRY_COLUMNS;
+  }
+  count = std::size(ACCESS_COLUMNS);
+  return ACCESS_COLUMNS;
+}
+
+size_t DataExport::nextRows(RowValues* out, size_t max) {
+  max = std::min(max, READ_BATCH);
+  size_t got = 0;
+  if (_kind == ExportKind::Telemetry) {
+    SensorRecord batch[READ_BATCH];
+    while (got == 0 && _sensorQuery.cursor < _sensorQuery.endSeq) {
+      got = _history.read(_sensorQuery, batch, max);
+    }
+    for (size_t i = 0; i < got; ++i) {
+      const SensorRecord& record = batch[i];
+      out[i] = {record.epoch, static_cast<uint16_t>(record.temperatureCenti),
+                record.humidityCenti, record.flags, 0};
+    }
+    return got;
+  }
+
+  AuditEntry batch[READ_BATCH];
+  while (got == 0 && _auditQuery.cursor < _auditQuery.endSeq) {
+    got = _audit.read(_auditQuery, batch, max);
+  }
+  for (size_t i = 0; i < got; ++i) {
+    const AuditRecord& record = batch[i].record;
+    out[i] = {batch[i].seq, record.epoch, record.type, record.userRef,
+              record.failedCount};
+  }
+  return got;
+}
+
+void DataExport::writeHeader() {
+  if (_format == ExportFormat::Binary) {
+    writeBinaryHeader();
+    return;
+  }
+  const char* header = _kind == ExportKind::Telemetry
+                           ? "epoch,temperature,humidity,fan1,fan2,alarm\n"
+                           : "seq,epoch,user,result,reason,failed\n";
+  _len = clampLen(snprintf(reinterpret_cast<char*>(_buf), BUFFER_SIZE, "%s",
+                           header),
+                  BUFFER_SIZE);
+}
+
+void DataExport::writeBinaryHeader() {
+  char* meta = reinterpret_cast<char*>(_buf) + BINARY_HEADER_SIZE;
+  const size_t cap = BUFFER_SIZE - BINARY_HEADER_SIZE;
+  size_t len = 0;
+  auto append = [&](const char* format, auto... args) {
+    len += clampLen(snprintf(meta + len, cap - len, format, args...),
+                    cap - len);
+  };
+
+  size_t count = 0;
+  const Column* cols = columns(count);
+  append("{\"kind\":\"%s\",\"columns\":[", kindName(_kind));
+  for (size_t i = 0; i < count; ++i) {
+    append("%s{\"name\":\"%s\",\"type\":\"%s\",\"scale\":%d}", i ? "," : "",
+           cols[i].name, cols[i].type, cols[i].scale);
+  }
+  append("]");
+  if (_kind == ExportKind::Access) {
+    // Indexed by the user column; names that do not fit are left out and
+    // the dashboard falls back to the index.
+    append(",\"users\":[\"\"");
+    char name[AuditLog::USER_ID_CAPACITY * 2];
+    for (uint8_t ref = 1; ref < _audit.userCount(); ++ref) {
+      copyJsonString(name, sizeof(name), _audit.userName(ref));
+      if (len + strlen(name) + 8 > cap) break;
+      append(",\"%s\"", name);
+    }
+    append("]");
+  }
+  append("}");
+  while (len % 4 != 0 && len + 1 < cap) meta[len++] = ' ';
+
+  memcpy(_buf, "SSXB", 4);
+  _buf[4] = BINARY_VERSION;
+  _buf[5] = static_cast<uint8_t>(_kind);
+  putLe(_buf + 6, 2, static_cast<uint32_t>(len));
+  _len = BINARY_HEADER_SIZE + len;
+}
+
+bool DataExport::writeBlock() {
+  size_t count = 0;
+  const Column* cols = columns(count);
+
+  // Columns are spread out for a full block while rows arrive, then packed
+  // down once the row count is known.
+  std::array<size_t, MAX_COLUMNS> offsets{};
+  size_t at = 4;
+  for (size_t c = 0; c < count; ++c) {
+    offsets[c] = at;
+    at += padded(BLOCK_ROWS * cols[c].size);
+  }
+
+  size_t rows = 0;
+  RowValues batch[READ_BATCH];
+  while (rows < BLOCK_ROWS) {
+    const size_t got = nextRows(batch, BLOCK_ROWS - rows);
+    if (got == 0) break;
+    for (size_t r = 0; r < got; ++r) {
+      for (size_t c = 0; c < count; ++c) {
+        putLe(_buf + offsets[c] + (rows + r) * cols[c].size, cols[c].size,
+              batch[r][c]);
+      }
+    }
+    rows += got;
+  }
+
+  putLe(_buf, 4, static_cast<uint32_t>(rows));
+  size_t packed = 4;
+  for (size_t c = 0; c < count; ++c) {
+    const size_t bytes = rows * cols[c].size;
+    memmove(_buf + packed, _buf + offsets[c], bytes);
+    memset(_buf + packed + bytes, 0, padded(bytes) - bytes);
+    packed += padded(bytes);
+  }
+  _len = packed;
+  _rows += rows;
+  return rows > 0;
+}
+
+bool DataExport::writeCsvRows() {
+  RowValues batch[CSV_BATCH];
+  const size_t got = nextRows(batch, CSV_BATCH);
+  for (size_t i = 0; i < got; ++i) {
+    _len += formatCsvRow(batch[i], reinterpret_cast<char*>(_buf) + _len,
+                         BUFFER_SIZE - _len);
+  }
+  _rows += got;
+  return got > 0;
+}
+
+size_t DataExport::formatCsvRow(const RowValues& row, char* out,
+                                size_t cap) const {
+  int len = 0;
+  if (_kind == ExportKind::Telemetry) {
+    char temperature[16];
+    char humidity[16];
+    writeFixed(temperature, sizeof(temperature), static_cast<int16_t>(row[1]),
+               2);
+    writeFixed(humidity, sizeof(humidity), static_cast<int32_t>(row[2]), 2);
+    len = snprintf(out, cap, "%lu,%s,%s,%u,%u,%u\n",
+                   static_cast<unsigned long>(row[0]), temperature, humidity,
+                   (row[3] & SENSOR_FLAG_FAN1) ? 1U : 0U,
+                   (row[3] & SENSOR_FLAG_FAN2) ? 1U : 0U,
+                   (row[3] & SENSOR_FLAG_ALARM) ? 1U : 0U);
+  } else {
+    const auto type = static_cast<AccessEventType>(row[2]);
+    char user[AuditLog::USER_ID_CAPACITY * 2 + 2];
+    copyCsvField(user, sizeof(user),
+                 _audit.userName(static_cast<uint8_t>(row[3])));
+    len = snprintf(out, cap, "%lu,%lu,%s,%s,%s,%lu\n",
+                   static_cast<unsigned long>(row[0]),
+                   static_cast<unsigned long>(row[1]), user,
+                   accessResultName(type), accessReasonName(type),
+                   static_cast<unsigned long>(row[4]));
+  }
+  return clampLen(len, cap);
+}
@@ -1,5 +1,8 @@
 #include "Display.h"
+
 #include "Config.h"
+#include "FixedPoint.h"
+#include "Trace.h"
 
 #include <time.h>
 
@@ -54,12 +57,14 @@ void Display::printRow(uint8_t row, const char* text) {
 }
 
 void Display::showStartup() {
+  TRACE_SCOPE("Display::showStartup");
   clear();
   printCenter(1, "Smart Server");
   printCenter(2, "Starting...");
 }
 
 void Display::showApMode(std::string_view ip) {
+  TRACE_SCOPE("Display::showApMode");
   clear();
   printCenter(0, "SETUP MODE");
   printCenter(1, "Connect AP:");
@@ -68,6 +73,7 @@ void Display::showApMode(std::string_view ip) {
 }
 
 void Display::showError(std::string_view message) {
+  TRACE_SCOPE("Display::showError");
   clear();
   printCenter(1, "ERROR");
   printCenter(2, message);
@@ -78,17 +84,18 @@ void Display::setWifiInfo(bool connected, const String& ip) {
   _ipAddress = ip;
 }
 
-void Display::setTelemetry(float temperature, float humidity, bool valid,
-                           bool fan1On, bool fan2On, bool warning) {
-  _temperature = temperature;
-  _humidity = humidity;
+void Display::setTelemetry(int16_t temperatureCenti, uint16_t humidityCenti,
+                           bool valid, bool fan1On, bool fan2On,
+                           bool warning) {
+  _temperatureCenti = temperatureCenti;
+  _humidityCenti = humidityCenti;
   _sensorValid = valid;
   _fan1On = fan1On;
   _fan2On = fan2On;
   _warning = warning;
 }
 
-void Display::setSecurity(const String& doorState, const String& accessMessage,
+void Display::setSecurity(const String& doorState, const char* accessMessage,
                           bool lockoutActive, uint32_t lockoutRemainSec) {
   _doorState = doorState;
   _accessMessage = accessMessage;
@@ -132,14 +139,19 @@ void Display::renderHeaderScroll() {
 }
 
 void Display::showMainScreen() {
+  TRACE_SCOPE("Display::showMainScreen");
   if (!_ready) return;
 
   renderHeaderScroll();
 
   char row1[32];
   if (_sensorValid) {
-    snprintf(row1, sizeof(row1), "T:%4.1fC H:%4.1f%%", static_cast<double>(_temperature),
-             static_cast<double>(_humidity));
+    char temperature[8];
+    char humidity[8];
+    writeFixed(temperature, sizeof(temperature),
+               divRound(_temperatureCenti, 10), 1);
+    writeFixed(humidity, sizeof(humidity), divRound(_humidityCenti, 10), 1);
+    snprintf(row1, sizeof(row1), "T:%4sC H:%4s%%", temperature, humidity);
   } else {
     snprintf(row1, sizeof(row1), "T:---- H:----");
   }
@@ -164,6 +176,7 @@ void Display::showMainScreen() {
 }
 
 void Display::showPinEntry(uint8_t pinLen, bool lockout, uint32_t lockSec) {
+  TRACE_SCOPE("Display::showPinEntry");
   if (!_ready) return;
   clear();
   printCenter(0, "== MASUKKAN PIN ==");
@@ -184,6 +197,7 @@ void Display::showPinEntry(uint8_t pinLen, bool lockout, uint32_t lockSec) {
 }
 
 void Display::showUnlockOk(const String& name) {
+  TRACE_SCOPE("Display::showUnlockOk");
   if (!_ready) return;
   clear();
   printCenter(0, "== AKSES DITERIMA ==");
@@ -193,6 +207,7 @@ void Display::showUnlockOk(const String& name) {
 }
 
 void Display::showAdminMenu() {
+  TRACE_SCOPE("Display::showAdminMenu");
   if (!_ready) return;
   clear();
   printRow(0, "== MENU ADMIN ==");
@@ -202,6 +217,7 @@ void Display::showAdminMenu() {
 }
 
 void Display::showUserList(const UserCredential* users, size_t maxUsers, uint8_t action) {
+  TRACE_SCOPE("Display::showUserList");
   if (!_ready) return;
   clear();
 
@@ -233,6 +249,7 @@ void Display::showUserList(const UserCredential* users, size_t maxUsers, uint8_t
 }
 
 void Display::showChangePin(const String& userId, uint8_t step, uint8_t len) {
+  TRACE_SCOPE("Display::showChangePin");
   if (!_ready) return;
   clear();
 
@@ -261,6 +278,7 @@ void Display::showChangePin(const String& userId, uint8_t step, uint8_t len) {
 }
 
 void Display::showAddUser(const String& autoId, uint8_t pinLen) {
+  TRACE_SCOPE("Display::showAddUser");
   if (!_ready) return;
   clear();
   printRow(0, "== TAMBAH USER ==");
@@ -279,6 +297,7 @@ void Display::showAddUser(const String& autoId, uint8_t pinLen) {
 }
 
 void Display::showConfirmDelete(const String& userId) {
+  TRACE_SCOPE("Display::showConfirmDelete");
   if (!_ready) return;
   clear();
   printRow(0, "== HAPUS USER? ==");
@@ -291,6 +310,7 @@ void Display::showConfirmDelete(const String& userId) {
 }
 
 void Display::showMessage(const char* title, const char* msg, bool success) {
+  TRACE_SCOPE("Display::showMessage");
   if (!_ready) return;
   clear();
   printCenter(0, title);
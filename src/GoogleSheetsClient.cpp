@@ -1,36 +1,23 @@
 #include "GoogleSheetsClient.h"
 
+#include "HeapTracker.h"
+#include "Metrics.h"
+#include "Trace.h"
+
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
 
-namespace {
-String urlEncode(const String& value) {
-  static const char* kHex = "0123456789ABCDEF";
-  String out;
-  out.reserve(value.length() * 3);
-
-  for (size_t i = 0; i < value.length(); ++i) {
-    const uint8_t c = static_cast<uint8_t>(value[i]);
-    if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
-        (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.' ||
-        c == '~') {
-      out += static_cast<char>(c);
-    } else {
-      out += '%';
-      out += kHex[(c >> 4) & 0x0F];
-      out += kHex[c & 0x0F];
-    }
-  }
-  return out;
-}
-}  // namespace
-
 void GoogleSheetsClient::begin(const String& scriptUrl) {
   _scriptUrl = scriptUrl;
   _configured = scriptUrl.length() > 0 && scriptUrl.startsWith("https://");
 }
 
-bool GoogleSheetsClient::sendGetRequest(const String& url) {
+bool GoogleSheetsClient::sendGetRequest(const UrlBuilder& url) {
+  TRACE_SCOPE("GoogleSheetsClient::sendGetRequest");
+  if (!url.ok()) {
+    _lastError = "URL too long";
+    return false;
+  }
   WiFiClientSecure client;
   client.setInsecure();
   client.setTimeout(20000);
@@ -39,14 +26,21 @@ bool GoogleSheetsClient::sendGetRequest(const String& url) {
   http.setTimeout(30000);
   http.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
 
-  if (!http.begin(client, url)) {
+  if (!http.begin(client, url.c_str())) {
     _lastError = "HTTP begin failed";
     return false;
   }
 
+  const int32_t rssi = WiFi.RSSI();
+  const uint32_t freeBefore = ESP.getFreeHeap();
+  const unsigned long startMs = millis();
   _lastHttpCode = http.GET();
   const String response = http.getString();
+  const uint32_t freeDuring = ESP.getFreeHeap();
+  HeapTracker::notePeak(HeapTag::HTTP,
+                        freeDuring < freeBefore ? freeBefore - freeDuring : 0);
   http.end();
+  Metrics::observeUpload(millis() - startMs, _lastHttpCode, rssi);
 
   if (_lastHttpCode != 200 && _lastHttpCode != 302) {
     _lastError = "HTTP " + String(_lastHttpCode) + ": " + response;
@@ -60,20 +54,56 @@ bool GoogleSheetsClient::sendTelemetry(const TelemetryLogPayload& payload) {
     _lastError = "Google Sheets not configured";
     return false;
   }
+  if (payload.sampleCount > 1) return sendTelemetryAggregate(payload);
+
+  UrlBuilder url(_scriptUrl.c_str());
+  url.text("sheet", "telemetry_logs")
+      .timestamp("timestamp", payload.epoch, payload.sampledAtMs, _timestamps)
+      .text("device_id", payload.deviceId)
+      .fixed("temperature_c", payload.temperatureCentiSum, 2)
+      .fixed("humidity_pct", static_cast<int32_t>(payload.humidityCentiSum), 2)
+      .boolean("fan1_on", payload.fan1On)
+      .boolean("fan2_on", payload.fan2On)
+      .text("alarm_state", payload.alarmState ? "ALARM" : "NORMAL")
+      .text("door_state", payload.doorState)
+      .integer("wifi_rssi", payload.wifiRssi)
+      .fixed("warn_threshold", divRound(payload.warnThresholdCenti, 10), 1)
+      .fixed("stage2_threshold", divRound(payload.stage2ThresholdCenti, 10),
+             1);
+  return sendGetRequest(url);
+}
+
+bool GoogleSheetsClient::sendTelemetryAggregate(
+    const TelemetryLogPayload& payload) {
+  if (!_configured) {
+    _lastError = "Google Sheets not configured";
+    return false;
+  }
 
-  String url = _scriptUrl;
-  url += "?sheet=telemetry_logs";
-  url += "&timestamp=" + urlEncode(payload.timestamp);
-  url += "&device_id=" + urlEncode(payload.deviceId);
-  url += "&temperature_c=" + String(payload.temperatureC, 2);
-  url += "&humidity_pct=" + String(payload.humidityPct, 2);
-  url += "&fan1_on=" + String(payload.fan1On ? "true" : "false");
-  url += "&fan2_on=" + String(payload.fan2On ? "true" : "false");
-  url += "&alarm_state=" + String(payload.alarmState ? "ALARM" : "NORMAL");
-  url += "&door_state=" + urlEncode(payload.doorState);
-  url += "&wifi_rssi=" + String(payload.wifiRssi);
-  url += "&warn_threshold=" + String(payload.warnThreshold, 1);
-  url += "&stage2_threshold=" + String(payload.stage2Threshold, 1);
+  const uint16_t count = max<uint16_t>(payload.sampleCount, 1);
+  UrlBuilder url(_scriptUrl.c_str());
+  url.text("sheet", "telemetry_aggregates")
+      .timestamp("period_start", payload.epoch, payload.sampledAtMs,
+                 _timestamps);
+  if (payload.periodEndEpoch != 0) {
+    url.timestamp("period_end", payload.periodEndEpoch, 0, _timestamps);
+  } else {
+    url.text("period_end", "");
+  }
+  url.text("device_id", payload.deviceId)
+      .integer("sample_count", payload.sampleCount)
+      .fixed("temperature_min_c", payload.temperatureMinCenti, 2)
+      .fixed("temperature_max_c", payload.temperatureMaxCenti, 2)
+      .fixed("temperature_avg_c", divRound(payload.temperatureCentiSum, count),
+             2)
+      .fixed("humidity_min_pct", payload.humidityMinCenti, 2)
+      .fixed("humidity_max_pct", payload.humidityMaxCenti, 2)
+      .fixed("humidity_avg_pct", divRound(payload.humidityCentiSum, count), 2)
+      .fixed("fan1_on_fraction", divRound(payload.fan1OnCount * 1000, count),
+             3)
+      .fixed("fan2_on_fraction", divRound(payload.fan2OnCount * 1000, count),
+             3)
+      .boolean("any_alarm", payload.alarmState);
   return sendGetRequest(url);
 }
 
@@ -83,16 +113,16 @@ bool GoogleSheetsClient::sendAccess(const AccessLogPayload& payload) {
     return false;
   }
 
-  String url = _scriptUrl;
-  url += "?sheet=access_logs";
-  url += "&timestamp=" + urlEncode(payload.timestamp);
-  url += "&device_id=" + urlEncode(payload.deviceId);
-  url += "&user_id=" + urlEncode(payload.userId);
-  url += "&display_name=" + urlEncode(payload.displayName);
-  url += "&result=" + urlEncode(payload.result);
-  url += "&reason=" + urlEncode(payload.reason);
-  url += "&failed_count=" + String(payload.failedCount);
-  url += "&lockout_until=" + String(payload.lockoutUntil);
-  url += "&door_state=" + urlEncode(payload.doorState);
+  UrlBuilder url(_scriptUrl.c_str());
+  url.text("sheet", "access_logs")
+      .timestamp("timestamp", payload.epoch, payload.sampledAtMs, _timestamps)
+      .text("device_id", payload.deviceId)
+      .text("user_id", payload.userId)
+      .text("display_name", payload.displayName)
+      .text("result", payload.result)
+      .text("reason", payload.reason)
+      .integer("failed_count", payload.failedCount)
+      .integer("lockout_until", payload.lockoutUntil)
+      .text("door_state", payload.doorState);
   return sendGetRequest(url);
 }
@@ -0,0 +1,155 @@
+#include "HeapTracker.h"
+
+#include <atomic>
+
+namespace {
+constexpr const char* TAG_NAMES[HeapTracker::TAG_COUNT] = {
+    "config", "access", "network", "wifi", "display", "sensors", "http",
+};
+
+constexpr const char* QUEUE_NAMES[HeapTracker::QUEUE_COUNT] = {
+    "upload_urgent", "upload_access", "upload_telemetry", "access_events",
+    "wifi_scan",
+};
+
+struct TagCounters {
+  std::atomic<uint32_t> live{0};
+  std::atomic<uint32_t> peak{0};
+  std::atomic<uint32_t> allocs{0};
+};
+
+TagCounters s_tags[HeapTracker::TAG_COUNT];
+std::atomic<uint32_t> s_queueHighWater[HeapTracker::QUEUE_COUNT];
+
+void raise(std::atomic<uint32_t>& slot, uint32_t value) {
+  uint32_t seen = slot.load(std::memory_order_relaxed);
+  while (value > seen &&
+         !slot.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+  }
+}
+
+class TrackedJsonAllocator : public ArduinoJson::Allocator {
+ public:
+  void bind(HeapTag tag) { _tag = tag; }
+
+  void* allocate(size_t size) override {
+    auto* block = static_cast<size_t*>(malloc(size + HEADER));
+    if (block == nullptr) return nullptr;
+    *block = size;
+    HeapTracker::onAlloc(_tag, size);
+    return reinterpret_cast<uint8_t*>(block) + HEADER;
+  }
+
+  void deallocate(void* ptr) override {
+    if (ptr == nullptr) return;
+    size_t* block = headerOf(ptr);
+    HeapTracker::onFree(_tag, *block);
+    free(block);
+  }
+
+  void* reallocate(void* ptr, size_t newSize) override {
+    if (ptr == nullptr) return allocate(newSize);
+    size_t* block = headerOf(ptr);
+    const size_t oldSize = *block;
+    auto* grown = static_cast<size_t*>(realloc(block, newSize + HEADER));
+    if (grown == nullptr) return nullptr;
+    *grown = newSize;
+    HeapTracker::onFree(_tag, oldSize);
+    HeapTracker::onAlloc(_tag, newSize);
+    return reinterpret_cast<uint8_t*>(grown) + HEADER;
+  }
+
+ private:
+  static constexpr size_t HEADER = 8;
+  HeapTag _tag = HeapTag::Config;
+
+  static size_t* headerOf(void* ptr) {
+    return reinterpret_cast<size_t*>(static_cast<uint8_t*>(ptr) - HEADER);
+  }
+};
+
+TrackedJsonAllocator s_jsonAllocators[HeapTracker::TAG_COUNT];
+}  // namespace
+
+namespace HeapTracker {
+
+void onAlloc(HeapTag tag, size_t bytes) {
+  TagCounters& c = s_tags[static_cast<size_t>(tag)];
+  const uint32_t live =
+      c.live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  c.allocs.fetch_add(1, std::memory_order_relaxed);
+  raise(c.peak, live);
+}
+
+void onFree(HeapTag tag, size_t bytes) {
+  s_tags[static_cast<size_t>(tag)].live.fetch_sub(bytes,
+                                                   std::memory_order_relaxed);
+}
+
+void notePeak(HeapTag tag, size_t bytes) {
+  TagCounters& c = s_tags[static_cast<size_t>(tag)];
+  c.allocs.fetch_add(1, std::memory_order_relaxed);
+  raise(c.peak, c.live.load(std::memory_order_relaxed) + bytes);
+}
+
+void noteQueueDepth(HeapQueue queue, size_t depth) {
+  raise(s_queueHighWater[static_cast<size_t>(queue)], depth);
+}
+
+HeapTagStats stats(HeapTag tag) {
+  const TagCounters& c = s_tags[static_cast<size_t>(tag)];
+  HeapTagStats out;
+  out.liveBytes = c.live.load(std::memory_order_relaxed);
+  out.peakBytes = c.peak.load(std::memory_order_relaxed);
+  out.allocCount = c.allocs.load(std::memory_order_relaxed);
+  return out;
+}
+
+uint32_t queueHighWater(HeapQueue queue) {
+  return s_queueHighWater[static_cast<size_t>(queue)].load(
+      std::memory_order_relaxed);
+}
+
+const char* tagName(HeapTag tag) {
+  const size_t i = static_cast<size_t>(tag);
+  return i < TAG_COUNT ? TAG_NAMES[i] : "unknown";
+}
+
+const char* queueName(HeapQueue queue) {
+  const size_t i = static_cast<size_t>(queue);
+  return i < QUEUE_COUNT ? QUEUE_NAMES[i] : "unknown";
+}
+
+ArduinoJson::Allocator* jsonAllocator(HeapTag tag) {
+  TrackedJsonAllocator& alloc = s_jsonAllocators[static_cast<size_t>(tag)];
+  alloc.bind(tag);
+  return &alloc;
+}
+
+void printReport(Print& out) {
+  out.printf("heap free=%lu min=%lu largest=%lu\n",
+             static_cast<unsigned long>(ESP.getFreeHeap()),
+             static_cast<unsigned long>(ESP.getMinFreeHeap()),
+             static_cast<unsigned long>(ESP.getMaxAllocHeap()));
+  out.printf("%-10s %8s %8s %8s\n", "tag", "live", "peak", "allocs");
+  for (size_t i = 0; i < TAG_COUNT; ++i) {
+    const HeapTagStats s = stats(static_cast<HeapTag>(i));
+    out.printf("%-10s %8lu %8lu %8lu\n", TAG_NAMES[i],
+               static_cast<unsigned long>(s.liveBytes),
+               static_cast<unsigned long>(s.peakBytes),
+               static_cast<unsigned long>(s.allocCount));
+  }
+  out.printf("%-18s %8s\n", "queue", "hwm");
+  for (size_t i = 0; i < QUEUE_COUNT; ++i) {
+    out.printf("%-18s %8lu\n", QUEUE_NAMES[i],
+               static_cast<unsigned long>(queueHighWater(
+                   static_cast<HeapQueue>(i))));
+  }
+}
+
+Scope::~Scope() {
+  const uint32_t freeAfter = ESP.getFreeHeap();
+  if (freeAfter < _freeBefore) onAlloc(_tag, _freeBefore - freeAfter);
+}
+
+}  // namespace HeapTracker
@@ -0,0 +1,231 @@
+#include "Metrics.h"
+
+#include <stdarg.h>
+
+namespace {
+constexpr size_t ROUTE_COUNT = static_cast<size_t>(Metrics::Route::Count);
+constexpr size_t HTTP_CODE_SLOTS = 8;
+
+constexpr const char* ROUTE_NAMES[ROUTE_COUNT] = {
+    "root",          "setup",         "state",         "batch",
+    "config_schema", "thermal_get",   "thermal_set",   "security_get",
+    "security_set",  "users_get",     "users_upsert",  "users_delete",
+    "users_import",  "users_export",  "send_now",      "access_log",
+    "export",        "wifi_scan",     "wifi_connect",  "wifi_job",
+    "metrics",       "trace",         "profile",       "heap",
+    "not_found",
+};
+
+struct RouteStats {
+  uint32_t count = 0;
+  uint64_t sumUs = 0;
+  uint32_t maxUs = 0;
+};
+
+struct HttpCodeCount {
+  int code = 0;
+  uint32_t count = 0;
+};
+
+Histogram<10> s_loopUs({100, 250, 500, 1000, 2500, 5000, 10000, 50000, 250000,
+                        1000000});
+Histogram<8> s_uploadMs({250, 500, 1000, 2000, 5000, 10000, 20000, 30000});
+Histogram<8> s_wifiConnectMs({500, 1000, 2000, 4000, 8000, 15000, 30000,
+                              60000});
+Histogram<8> s_dispatchNs({250, 500, 1000, 2000, 4000, 8000, 16000, 64000});
+Histogram<8> s_unlockUs({1000, 5000, 10000, 25000, 50000, 100000, 250000,
+                         1000000});
+uint32_t s_wifiFastConnects = 0;
+uint32_t s_wifiRoams = 0;
+
+struct RssiBand {
+  const char* label;
+  int32_t floorDbm;
+  uint32_t ok = 0;
+  uint32_t failed = 0;
+  uint64_t sumMs = 0;
+  uint32_t maxMs = 0;
+};
+std::array<RssiBand, 4> s_rssiBands = {{
+    {"ge-60", -60},
+    {"ge-70", -70},
+    {"ge-80", -80},
+    {"lt-80", INT32_MIN},
+}};
+uint32_t s_wifiScanConnects = 0;
+std::array<RouteStats, ROUTE_COUNT> s_routes;
+std::array<HttpCodeCount, HTTP_CODE_SLOTS> s_httpCodes;
+uint32_t s_httpCodesOther = 0;
+}  // namespace
+
+MetricsWriter::MetricsWriter(char* buf, size_t cap) : _buf(buf), _cap(cap) {
+  if (_cap > 0) _buf[0] = '\0';
+}
+
+void MetricsWriter::append(const char* fmt, ...) {
+  if (_truncated || _len >= _cap) {
+    _truncated = true;
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  const int written = vsnprintf(_buf + _len, _cap - _len, fmt, args);
+  va_end(args);
+  if (written < 0 || static_cast<size_t>(written) >= _cap - _len) {
+    _buf[_len] = '\0';
+    _truncated = true;
+    return;
+  }
+  _len += static_cast<size_t>(written);
+}
+
+void MetricsWriter::family(const char* name, const char* type,
+                           const char* help) {
+  append("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void MetricsWriter::sample(const char* name, const char* labels,
+                           int64_t value) {
+  if (labels != nullptr) {
+    append("%s{%s} %lld\n", name, labels, static_cast<long long>(value));
+  } else {
+    append("%s %lld\n", name, static_cast<long long>(value));
+  }
+}
+
+namespace Metrics {
+
+void observeLoop(uint32_t durationUs) { s_loopUs.observe(durationUs); }
+
+void observeUpload(uint32_t durationMs, int httpCode, int32_t rssi) {
+  s_uploadMs.observe(durationMs);
+  for (auto& band : s_rssiBands) {
+    if (rssi < band.floorDbm) continue;
+    ++((httpCode == 200 || httpCode == 302) ? band.ok : band.failed);
+    band.sumMs += durationMs;
+    band.maxMs = max(band.maxMs, durationMs);
+    break;
+  }
+
+  for (auto& slot : s_httpCodes) {
+    if (slot.count > 0 && slot.code == httpCode) {
+      ++slot.count;
+      return;
+    }
+    if (slot.count == 0) {
+      slot.code = httpCode;
+      slot.count = 1;
+      return;
+    }
+  }
+  ++s_httpCodesOther;
+}
+
+void observeRoute(Route route, uint32_t durationUs) {
+  RouteStats& stats = s_routes[static_cast<size_t>(route)];
+  ++stats.count;
+  stats.sumUs += durationUs;
+  stats.maxUs = max(stats.maxUs, durationUs);
+}
+
+void observeDispatch(uint32_t durationNs) { s_dispatchNs.observe(durationNs); }
+
+void observeWiFiConnect(uint32_t durationMs, bool fastPath) {
+  s_wifiConnectMs.observe(durationMs);
+  ++(fastPath ? s_wifiFastConnects : s_wifiScanConnects);
+}
+
+void observeRoam() { ++s_wifiRoams; }
+
+void observeUnlockLatency(uint32_t durationUs) {
+  s_unlockUs.observe(durationUs);
+}
+
+const char* routeName(Route route) {
+  const size_t i = static_cast<size_t>(route);
+  return i < ROUTE_COUNT ? ROUTE_NAMES[i] : "unknown";
+}
+
+void writeCollected(MetricsWriter& out) {
+  out.histogram("smartserver_loop_duration_us", "Main loop iteration time",
+                s_loopUs);
+  out.histogram("smartserver_upload_duration_ms",
+                "Google Sheets request time", s_uploadMs);
+
+  out.histogram("smartserver_route_dispatch_ns",
+                "Route table lookup per dispatched request", s_dispatchNs);
+  out.histogram("smartserver_unlock_latency_us",
+                "Final keypress to solenoid relay switch", s_unlockUs);
+  out.histogram("smartserver_wifi_connect_duration_ms",
+                "Time from link loss or boot to verified connection",
+                s_wifiConnectMs);
+  out.family("smartserver_wifi_connects_total", "counter",
+             "Verified connections by path");
+  out.sample("smartserver_wifi_connects_total", "path=\"fast\"",
+             s_wifiFastConnects);
+  out.sample("smartserver_wifi_connects_total", "path=\"scan\"",
+             s_wifiScanConnects);
+
+  out.family("smartserver_wifi_roams_total", "counter",
+             "Roams to a stronger saved AP while connected");
+  out.sample("smartserver_wifi_roams_total", nullptr, s_wifiRoams);
+
+  char labels[48];
+  out.family("smartserver_upload_by_rssi_total", "counter",
+             "Upload outcomes by RSSI band at request time");
+  for (const auto& band : s_rssiBands) {
+    snprintf(labels, sizeof(labels), "band=\"%s\",result=\"ok\"",
+             band.label);
+    out.sample("smartserver_upload_by_rssi_total", labels, band.ok);
+    snprintf(labels, sizeof(labels), "band=\"%s\",result=\"failed\"",
+             band.label);
+    out.sample("smartserver_upload_by_rssi_total", labels, band.failed);
+  }
+  out.family("smartserver_upload_by_rssi_duration_ms_sum", "counter",
+             "Total upload time by RSSI band");
+  for (const auto& band : s_rssiBands) {
+    snprintf(labels, sizeof(labels), "band=\"%s\"", band.label);
+    out.sample("smartserver_upload_by_rssi_duration_ms_sum", labels,
+               static_cast<int64_t>(band.sumMs));
+  }
+  out.family("smartserver_upload_by_rssi_duration_ms_max", "gauge",
+             "Slowest upload by RSSI band");
+  for (const auto& band : s_rssiBands) {
+    snprintf(labels, sizeof(labels), "band=\"%s\"", band.label);
+    out.sample("smartserver_upload_by_rssi_duration_ms_max", labels,
+               band.maxMs);
+  }
+
+  out.family("smartserver_upload_http_responses_total", "counter",
+             "Upload results by HTTP code (negative = client error)");
+  for (const auto& slot : s_httpCodes) {
+    if (slot.count == 0) break;
+    snprintf(labels, sizeof(labels), "code=\"%d\"", slot.code);
+    out.sample("smartserver_upload_http_responses_total", labels, slot.count);
+  }
+  out.sample("smartserver_upload_http_responses_total", "code=\"other\"",
+             s_httpCodesOther);
+
+  out.family("smartserver_http_requests_total", "counter",
+             "Local API requests by route");
+  for (size_t i = 0; i < ROUTE_COUNT; ++i) {
+    snprintf(labels, sizeof(labels), "route=\"%s\"", ROUTE_NAMES[i]);
+    out.sample("smartserver_http_requests_total", labels, s_routes[i].count);
+  }
+  out.family("smartserver_http_request_duration_us_sum", "counter",
+             "Total handler time by route");
+  for (size_t i = 0; i < ROUTE_COUNT; ++i) {
+    snprintf(labels, sizeof(labels), "route=\"%s\"", ROUTE_NAMES[i]);
+    out.sample("smartserver_http_request_duration_us_sum", labels,
+               static_cast<int64_t>(s_routes[i].sumUs));
+  }
+  out.family("smartserver_http_request_duration_us_max", "gauge",
+             "Slowest handler time by route");
+  for (size_t i = 0; i < ROUTE_COUNT; ++i) {
+    snprintf(labels, sizeof(labels), "route=\"%s\"", ROUTE_NAMES[i]);
+    out.sample("smartserver_http_request_duration_us_max", labels,
+               s_routes[i].maxUs);
+  }
+}
+
+}  // namespace Metrics
@@ -1,14 +1,393 @@
 #include "NetworkServices.h"
 
+#include "Admission.h"
+#include "ConfigSchema.h"
+#include "DataExport.h"
+#include "HeapTracker.h"
+#include "Metrics.h"
+#include "Profiler.h"
+#include "RequestArena.h"
+#include "Routes.h"
+#include "Trace.h"
 #include "WebPage.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <time.h>
 
 namespace {
 constexpr uint16_t MAX_QUEUE_SIZE = 300;
+constexpr uint16_t MAX_URGENT_QUEUE_SIZE = 20;
+constexpr unsigned long URGENT_RETRY_BASE_MS = 250;
+constexpr unsigned long URGENT_RETRY_MAX_MS = 5000;
+constexpr size_t METRICS_BUFFER_SIZE = 8192;
+constexpr uint16_t AUDIT_DEFAULT_LIMIT = 50;
+constexpr uint16_t AUDIT_MAX_LIMIT = 500;
+constexpr size_t AUDIT_BATCH = 8;
+constexpr time_t MIN_VALID_EPOCH = 1700000000;
+// Stage 2 clears this far below its threshold so a reading hovering on the
+// threshold does not queue an urgent row on every sample.
+constexpr int32_t STAGE2_CLEAR_MARGIN_CENTI = 30;
+
+char s_metricsBuffer[METRICS_BUFFER_SIZE];
+std::atomic<bool> s_metricsBusy{false};
+
+void serializeWiFiJob(const ConnectJob& job, char* out, size_t cap) {
+  JsonDocument doc;
+  doc["jobId"] = job.id;
+  doc["state"] = WiFiManager::jobStateName(job.state);
+  doc["ssid"] = job.ssid;
+  if (job.error.length() > 0) doc["error"] = job.error;
+  if (job.ip.length() > 0) doc["ip"] = job.ip;
+  serializeJson(doc, out, cap);
+}
+
+constexpr size_t IMPORT_MAX_BYTES = 8192;
+
+// Chunked responses format one record at a time into `text` and copy it out
+// across as many fill callbacks as the socket needs.
+struct TextChunk {
+  char text[160];
+  size_t textLen = 0;
+  size_t textPos = 0;
+};
+
+template <typename Stream, typename Refill>
+size_t pumpText(Stream& stream, uint8_t* buf, size_t maxLen, Refill refill) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (stream.textPos == stream.textLen) {
+      stream.textPos = 0;
+      if (!refill(stream)) break;
+    }
+    const size_t n =
+        std::min(maxLen - written, stream.textLen - stream.textPos);
+    memcpy(buf + written, stream.text + stream.textPos, n);
+    stream.textPos += n;
+    written += n;
+  }
+  return written;
+}
+
+size_t finishText(TextChunk& chunk, int len) {
+  chunk.textLen =
+      std::min<size_t>(std::max(len, 0), sizeof(chunk.text) - 1);
+  return chunk.textLen;
+}
+
+enum class AuditPhase : uint8_t { Open, Entries, Close, Done };
+
+struct AuditStream : TextChunk {
+  AuditLog* log = nullptr;
+  AuditQuery query;
+  uint16_t remaining = 0;
+  AuditPhase phase = AuditPhase::Open;
+  bool first = true;
+  AuditEntry batch[AUDIT_BATCH];
+  size_t batchLen = 0;
+  size_t batchPos = 0;
+};
+
+bool nextAuditEntry(AuditStream& stream, AuditEntry& out) {
+  while (stream.batchPos == stream.batchLen) {
+    if (stream.remaining == 0 ||
+        stream.query.cursor >= stream.query.endSeq) {
+      return false;
+    }
+    stream.batchLen = stream.log->read(
+        stream.query, stream.batch,
+        std::min<size_t>(AUDIT_BATCH, stream.remaining));
+    stream.batchPos = 0;
+    stream.remaining -= stream.batchLen;
+  }
+  out = stream.batch[stream.batchPos++];
+  return true;
+}
+
+bool refillAuditStream(AuditStream& stream) {
+  int len = 0;
+  switch (stream.phase) {
+    case AuditPhase::Open:
+      len = snprintf(stream.text, sizeof(stream.text),
+                     "{\"first\":%lu,\"last\":%lu,\"entries\":[",
+                     static_cast<unsigned long>(stream.log->firstSeq()),
+                     static_cast<unsigned long>(stream.query.endSeq));
+      stream.phase = AuditPhase::Entries;
+      break;
+    case AuditPhase::Entries: {
+      AuditEntry entry;
+      if (!nextAuditEntry(stream, entry)) {
+        stream.phase = AuditPhase::Close;
+        return refillAuditStream(stream);
+      }
+      const auto type = static_cast<AccessEventType>(entry.record.type);
+      char user[AuditLog::USER_ID_CAPACITY * 2];
+      copyJsonString(user, sizeof(user),
+                     stream.log->userName(entry.record.userRef));
+      len = snprintf(stream.text, sizeof(stream.text),
+                     "%s{\"seq\":%lu,\"ts\":%lu,\"user\":\"%s\","
+                     "\"result\":\"%s\",\"reason\":\"%s\",\"failed\":%u}",
+                     stream.first ? "" : ",",
+                     static_cast<unsigned long>(entry.seq),
+                     static_cast<unsigned long>(entry.record.epoch), user,
+                     accessResultName(type), accessReasonName(type),
+                     static_cast<unsigned>(entry.record.failedCount));
+      stream.first = false;
+      break;
+    }
+    case AuditPhase::Close:
+      if (stream.query.cursor < stream.query.endSeq) {
+        len = snprintf(stream.text, sizeof(stream.text), "],\"next\":%lu}",
+                       static_cast<unsigned long>(stream.query.cursor));
+      } else {
+        len = snprintf(stream.text, sizeof(stream.text), "],\"next\":null}");
+      }
+      stream.phase = AuditPhase::Done;
+      break;
+    case AuditPhase::Done:
+      return false;
+  }
+  finishText(stream, len);
+  return true;
+}
+
+struct UserExportStream : TextChunk {
+  const ConfigManager* config = nullptr;
+  bool csv = false;
+  bool headerSent = false;
+  size_t index = 0;
+};
+
+// Snapshots are pinned per record, never across fill callbacks, so a slow
+// client cannot hold up a config writer.
+bool refillUserExport(UserExportStream& stream) {
+  if (stream.csv && !stream.headerSent) {
+    stream.headerSent = true;
+    finishText(stream, snprintf(stream.text, sizeof(stream.text),
+                                "userId,displayName,pin,enabled\n"));
+    return true;
+  }
+  const ConfigSnapshot config = stream.config->read();
+  while (stream.index < config->users.size() &&
+         config->users[stream.index].userId.length() == 0) {
+    ++stream.index;
+  }
+  if (stream.index >= config->users.size()) return false;
+
+  const UserCredential& user = config->users[stream.index++];
+  char id[48];
+  char name[72];
+  int len = 0;
+  if (stream.csv) {
+    copyCsvField(id, sizeof(id), user.userId.c_str());
+    copyCsvField(name, sizeof(name), user.displayName.c_str());
+    len = snprintf(stream.text, sizeof(stream.text), "%s,%s,,%s\n", id, name,
+                   user.enabled ? "true" : "false");
+  } else {
+    copyJsonString(id, sizeof(id), user.userId.c_str());
+    copyJsonString(name, sizeof(name), user.displayName.c_str());
+    len = snprintf(stream.text, sizeof(stream.text),
+                   "{\"userId\":\"%s\",\"displayName\":\"%s\","
+                   "\"enabled\":%s}\n",
+                   id, name, user.enabled ? "true" : "false");
+  }
+  finishText(stream, len);
+  return true;
+}
+
+// A request holds a single disconnect callback and the admission middleware
+// uses it to return the in-flight slot. Handlers that need their own cleanup
+// on an admitted request register it here so the slot is still returned.
+template <typename Fn>
+void onAdmittedDisconnect(AsyncWebServerRequest* request, Fn cleanup) {
+  request->onDisconnect([cleanup]() {
+    cleanup();
+    Admission::release();
+  });
+}
+
+RequestArena* arenaFor(AsyncWebServerRequest* request) {
+  RequestArena* arena = RequestArena::acquire();
+  onAdmittedDisconnect(request, [arena]() { RequestArena::release(arena); });
+  return arena;
+}
+
+enum class BatchPart : uint8_t {
+  State,
+  Schema,
+  Thermal,
+  Security,
+  Users,
+  WiFi,
+  Count
+};
+constexpr size_t BATCH_PART_COUNT = static_cast<size_t>(BatchPart::Count);
+constexpr const char* BATCH_PART_NAMES[BATCH_PART_COUNT] = {
+    "state", "schema", "thermal", "security", "users", "wifi"};
+constexpr uint8_t BATCH_PART_COSTS[BATCH_PART_COUNT] = {1, 1, 1, 1, 1, 4};
+constexpr size_t BATCH_MAX_PARTS = BATCH_PART_COUNT;
+
+// Splits a comma separated `r` list into parts. On an unknown name returns
+// false and leaves it in `unknown`.
+bool parseBatch(const String& list, BatchPart* parts, size_t& count,
+                char* unknown, size_t unknownCap) {
+  char buf[96];
+  snprintf(buf, sizeof(buf), "%s", list.c_str());
+  count = 0;
+  char* save = nullptr;
+  for (char* name = strtok_r(buf, ",", &save); name != nullptr;
+       name = strtok_r(nullptr, ",", &save)) {
+    size_t i = 0;
+    while (i < BATCH_PART_COUNT && strcmp(name, BATCH_PART_NAMES[i]) != 0) ++i;
+    if (i == BATCH_PART_COUNT) {
+      snprintf(unknown, unknownCap, "%s", name);
+      return false;
+    }
+    if (count < BATCH_MAX_PARTS) parts[count++] = static_cast<BatchPart>(i);
+  }
+  return true;
+}
+
+uint8_t batchCost(AsyncWebServerRequest* request) {
+  if (!request->hasParam("r")) return 1;
+  BatchPart parts[BATCH_MAX_PARTS];
+  size_t count = 0;
+  char unknown[24];
+  parseBatch(request->getParam("r")->value(), parts, count, unknown,
+             sizeof(unknown));
+  uint8_t cost = 0;
+  for (size_t i = 0; i < count; ++i) {
+    cost += BATCH_PART_COSTS[static_cast<size_t>(parts[i])];
+  }
+  return std::max<uint8_t>(cost, 1);
+}
+
+RouteMethod routeMethod(WebRequestMethodComposite method) {
+  switch (method) {
+    case HTTP_GET:
+      return RouteMethod::Get;
+    case HTTP_POST:
+      return RouteMethod::Post;
+    case HTTP_DELETE:
+      return RouteMethod::Delete;
+    default:
+      return RouteMethod::Count;
+  }
+}
+
+Routes::Trie::Index findRoute(AsyncWebServerRequest* request,
+                              RouteParams& params) {
+  const String& url = request->url();
+  return Routes::TRIE.match(routeMethod(request->method()),
+                            std::string_view(url.c_str(), url.length()),
+                            params);
+}
+
+uint8_t requestCost(AsyncWebServerRequest* request) {
+  RouteParams params;
+  const auto index = findRoute(request, params);
+  if (index >= Routes::Trie::WRONG_METHOD) return 1;
+  const uint8_t cost = Routes::TABLE[index].cost;
+  return cost != 0 ? cost : batchCost(request);
+}
+
+void rejectRequest(AsyncWebServerRequest* request,
+                   const AdmissionDecision& decision) {
+  const bool limited = decision.verdict == AdmissionVerdict::RateLimited;
+  AsyncWebServerResponse* response = request->beginResponse(
+      limited ? 429 : 503, "application/json",
+      limited ? "{\"error\":\"rate limited\"}" : "{\"error\":\"busy\"}");
+  response->addHeader("Retry-After", String(decision.retryAfterSec));
+  request->send(response);
+}
+
+constexpr size_t ETAG_SIZE = 20;
+
+void formatEtag(char* out, size_t cap, uint32_t version) {
+  snprintf(out, cap, "\"cfg-%lu\"", static_cast<unsigned long>(version));
+}
+
+// True when the header lists `etag` (weak or strong) or is "*".
+bool headerMatches(AsyncWebServerRequest* request, const char* name,
+                   const char* etag) {
+  const AsyncWebHeader* header = request->getHeader(name);
+  if (header == nullptr) return false;
+  const String& value = header->value();
+  return value == "*" || value.indexOf(etag) >= 0;
+}
+
+void addEtag(AsyncWebServerResponse* response, const char* etag) {
+  if (etag == nullptr) return;
+  response->addHeader("ETag", etag);
+  // Cache, but check back every time; a matching ETag costs one 304.
+  response->addHeader("Cache-Control", "no-cache");
+}
+
+bool sendNotModified(AsyncWebServerRequest* request, const char* etag) {
+  if (!headerMatches(request, "If-None-Match", etag)) return false;
+  AsyncWebServerResponse* response = request->beginResponse(304);
+  addEtag(response, etag);
+  request->send(response);
+  return true;
+}
+
+// If-Match is evaluated inside the config write against the version it
+// replaces; the loop also writes config (keypad PIN changes, WiFi), so a
+// check made before the write could pass on a version that is already gone.
+// `stale` is set when the precondition turned the write down.
+ConfigManager::Precondition ifMatch(AsyncWebServerRequest* request,
+                                    bool& stale) {
+  stale = false;
+  return [request, &stale](const AppConfig& config) {
+    if (!request->hasHeader("If-Match")) return true;
+    char etag[ETAG_SIZE];
+    formatEtag(etag, sizeof(etag), config.version);
+    stale = !headerMatches(request, "If-Match", etag);
+    return !stale;
+  };
+}
+
+void sendPreconditionFailed(AsyncWebServerRequest* request,
+                            uint32_t version) {
+  char etag[ETAG_SIZE];
+  formatEtag(etag, sizeof(etag), version);
+  AsyncWebServerResponse* response = request->beginResponse(
+      412, "application/json", "{\"error\":\"config changed\"}");
+  addEtag(response, etag);
+  request->send(response);
+}
+
+void sendSaved(AsyncWebServerRequest* request, uint32_t version) {
+  char etag[ETAG_SIZE];
+  formatEtag(etag, sizeof(etag), version);
+  AsyncWebServerResponse* response =
+      request->beginResponse(200, "application/json", "{\"success\":true}");
+  addEtag(response, etag);
+  request->send(response);
+}
+
+void sendJson(AsyncWebServerRequest* request, RequestArena* arena,
+              const JsonDocument& doc, const char* etag = nullptr) {
+  const size_t len = measureJson(doc);
+  char* buf = arena->allocText(len + 1);
+  AsyncWebServerResponse* response = nullptr;
+  if (buf == nullptr) {
+    String body;
+    serializeJson(doc, body);
+    response = request->beginResponse(200, "application/json", body);
+  } else {
+    serializeJson(doc, buf, len + 1);
+    response = request->beginResponse(
+        200, "application/json", reinterpret_cast<const uint8_t*>(buf), len);
+  }
+  addEtag(response, etag);
+  request->send(response);
 }
+}  // namespace
 
-NetworkServices::NetworkServices() : _server(80) {}
+NetworkServices::NetworkServices()
+    : _server(80), _wifiEvents("/api/wifi/events") {}
 
 void NetworkServices::begin(ConfigManager* config, WiFiManager* wifi,
                             SensorManager* sensors, AccessController* access) {
@@ -17,56 +396,145 @@ void NetworkServices::begin(ConfigManager* config, WiFiManager* wifi,
   _sensors = sensors;
   _access = access;
 
-  _googleSheets.begin(_config->data.googleScriptUrl);
+  _uploadEvents = _access->events().subscribe();
+  _metricsEvents = _access->events().subscribe();
+  _auditEvents = _access->events().subscribe();
+  _auditLog.begin();
+  _history.begin();
+
+  _googleSheets.begin(_config->read()->googleScriptUrl);
+  setupUploadPolicies();
   configTime(7 * 3600, 0, "pool.ntp.org", "time.nist.gov");
 
+  setupAdmission();
   setupRoutes();
-  setupWiFiRoutes();
   _server.begin();
 }
 
 void NetworkServices::update(const SensorData& data, bool fan1On, bool fan2On,
                              bool warning, bool solenoidOn) {
-  _cachedData = data;
-  _cachedFan1On = fan1On;
-  _cachedFan2On = fan2On;
-  _cachedWarning = warning;
-  _cachedSolenoidOn = solenoidOn;
+  _live.store({data, fan1On, fan2On, warning, solenoidOn});
+  drainAccessEvents();
+  recordHistory(data, fan1On, fan2On, warning);
+
+  const ConfigSnapshot config = _config->read();
+  const int32_t stage2Centi = toCenti(config->stage2ThresholdC);
+  const int32_t stage2Bound =
+      _stage2Active ? stage2Centi - STAGE2_CLEAR_MARGIN_CENTI : stage2Centi;
+  const bool stage2Now = data.valid && data.temperatureCenti >= stage2Bound;
+  if (stage2Now != _stage2Active) {
+    _stage2Active = stage2Now;
+    enqueueTelemetry(true);
+  }
 
   if (_wifi->isConnected()) {
     if (millis() - _lastTelemetryEnqueueMs >=
-        (_config->data.cloudSendIntervalSec * 1000UL)) {
+        (config->cloudSendIntervalSec * 1000UL)) {
       _lastTelemetryEnqueueMs = millis();
       enqueueTelemetry();
       _lastSendEpoch = static_cast<unsigned long>(time(nullptr));
     }
     flushQueueTick();
   }
+
+  publishWiFiJob();
+}
+
+void NetworkServices::recordHistory(const SensorData& data, bool fan1On,
+                                    bool fan2On, bool warning) {
+  if (!data.valid ||
+      millis() - _lastHistoryMs < SensorHistory::SAMPLE_INTERVAL_MS) {
+    return;
+  }
+  const time_t now = time(nullptr);
+  if (now < MIN_VALID_EPOCH) return;
+  _lastHistoryMs = millis();
+
+  SensorRecord record;
+  record.epoch = static_cast<uint32_t>(now);
+  record.temperatureCenti = data.temperatureCenti;
+  record.humidityCenti = data.humidityCenti;
+  record.flags = (fan1On ? SENSOR_FLAG_FAN1 : 0) |
+                 (fan2On ? SENSOR_FLAG_FAN2 : 0) |
+                 (warning ? SENSOR_FLAG_ALARM : 0);
+  _history.append(record);
+}
+
+void NetworkServices::publishWiFiJob() {
+  const uint32_t revision = _wifi->jobRevision();
+  if (revision == _publishedJobRevision) return;
+  _publishedJobRevision = revision;
+  if (_wifiEvents.count() == 0) return;
+
+  const ConnectJob job = _wifi->connectJob();
+  char payload[160];
+  serializeWiFiJob(job, payload, sizeof(payload));
+  _wifiEvents.send(payload, "job", job.id);
+}
+
+void NetworkServices::drainAccessEvents() {
+  auto& bus = _access->events();
+  HeapTracker::noteQueueDepth(HeapQueue::AccessEvents,
+                              bus.backlog(_uploadEvents));
+  AccessEvent event;
+  while (bus.poll(_uploadEvents, event)) logAccessEvent(event);
+  while (bus.poll(_auditEvents, event)) _auditLog.append(event);
+  while (bus.poll(_metricsEvents, event)) {
+    const size_t type = static_cast<size_t>(event.type);
+    if (type < _accessEventCounts.size()) ++_accessEventCounts[type];
+  }
 }
 
 void NetworkServices::logAccessEvent(const AccessEvent& event) {
   AccessLogPayload payload;
-  payload.timestamp = makeTimestampIso8601();
-  payload.deviceId = _config->data.deviceId;
-  payload.userId = event.userId.length() > 0 ? event.userId : "unknown";
-  payload.displayName =
-      event.displayName.length() > 0 ? event.displayName : "Unknown";
-  payload.result = event.result;
-  payload.reason = event.reason;
+  payload.epoch = static_cast<uint32_t>(time(nullptr));
+  strlcpy(payload.deviceId, _config->read()->deviceId.c_str(),
+          sizeof(payload.deviceId));
+  strlcpy(payload.userId, event.userId[0] != '\0' ? event.userId : "unknown",
+          sizeof(payload.userId));
+  strlcpy(payload.displayName,
+          event.displayName[0] != '\0' ? event.displayName : "Unknown",
+          sizeof(payload.displayName));
+  payload.result = accessResultName(event.type);
+  payload.reason = accessReasonName(event.type);
   payload.failedCount = event.failedCount;
   payload.lockoutUntil = event.lockoutUntilEpoch;
   payload.doorState = doorState();
-  enqueueAccessPayload(payload);
+  payload.sampledAtMs = event.atMs;
+
+  const UploadClass cls = event.type == AccessEventType::LockoutStarted
+                              ? UploadClass::Urgent
+                              : UploadClass::Access;
+  enqueueUpload(cls, UploadItem{payload, millis()});
 }
 
-void NetworkServices::enqueueTelemetryPayload(const TelemetryLogPayload& payload) {
-  _telemetryQueue.push_back(payload);
-  if (_telemetryQueue.size() > MAX_QUEUE_SIZE) _telemetryQueue.pop_front();
+void NetworkServices::setupUploadPolicies() {
+  ClassPolicy urgent;
+  urgent.preempt = true;
+  urgent.capacity = MAX_URGENT_QUEUE_SIZE;
+  urgent.overflow = OverflowPolicy::KeepNewest;
+  _uploads.configure(UploadClass::Urgent, urgent);
+
+  ClassPolicy access;
+  access.weight = 4;
+  access.capacity = MAX_QUEUE_SIZE;
+  access.overflow = OverflowPolicy::KeepOldest;
+  access.agingMs = 60000;
+  _uploads.configure(UploadClass::Access, access);
+
+  ClassPolicy telemetry;
+  telemetry.weight = 1;
+  telemetry.capacity = MAX_QUEUE_SIZE;
+  telemetry.overflow = OverflowPolicy::Coalesce;
+  telemetry.agingMs = 30000;
+  _uploads.configure(UploadClass::Telemetry, telemetry);
 }
 
-void NetworkServices::enqueueAccessPayload(const AccessLogPayload& payload) {
-  _accessQueue.push_back(payload);
-  if (_accessQueue.size() > MAX_QUEUE_SIZE) _accessQueue.pop_front();
+void NetworkServices::enqueueUpload(UploadClass cls, UploadItem item) {
+  if (!_uploads.enqueue(cls, std::move(item))) {
+    Serial.printf("Upload queue %s full, item dropped\n",
+                  UploadScheduler::className(cls));
+  }
 }
 
 void NetworkServices::backoff() {
@@ -75,31 +543,65 @@ void NetworkServices::backoff() {
   _nextAttemptMs = millis() + min(delayMs, 60000UL);
 }
 
+void NetworkServices::urgentBackoff() {
+  _urgentRetryCount = min<uint8_t>(_urgentRetryCount + 1, 5);
+  const unsigned long delayMs = URGENT_RETRY_BASE_MS << _urgentRetryCount;
+  _nextUrgentAttemptMs = millis() + min(delayMs, URGENT_RETRY_MAX_MS);
+}
+
+bool NetworkServices::hasUrgent() const {
+  return _uploads.size(UploadClass::Urgent) > 0;
+}
+
 bool NetworkServices::sendOne() {
   if (!_googleSheets.isConfigured()) return false;
 
+  const UploadClass cls = _uploads.next(millis());
+  if (cls == UploadClass::Count) return true;
+
+  const UploadItem& item = _uploads.front(cls);
+  unsigned long sampledAtMs = 0;
   bool ok = false;
-  if (!_accessQueue.empty()) {
-    ok = _googleSheets.sendAccess(_accessQueue.front());
-    if (ok) _accessQueue.pop_front();
-  } else if (!_telemetryQueue.empty()) {
-    ok = _googleSheets.sendTelemetry(_telemetryQueue.front());
-    if (ok) _telemetryQueue.pop_front();
+  if (const auto* access = std::get_if<AccessLogPayload>(&item.payload)) {
+    sampledAtMs = access->sampledAtMs;
+    ok = _googleSheets.sendAccess(*access);
   } else {
-    return true;
+    const auto& telemetry = std::get<TelemetryLogPayload>(item.payload);
+    sampledAtMs = telemetry.sampledAtMs;
+    ok = _googleSheets.sendTelemetry(telemetry);
+  }
+
+  const bool urgent = cls == UploadClass::Urgent;
+  if (!ok) {
+    if (urgent) {
+      urgentBackoff();
+    } else {
+      backoff();
+    }
+    return false;
   }
 
-  if (ok) {
+  _uploads.complete(cls, millis());
+  if (urgent) {
+    _urgentRetryCount = 0;
+    _nextUrgentAttemptMs = millis();
+    if (_googleSheets.getLastHttpCode() == 200) {
+      _lastUrgentLatencyMs = millis() - sampledAtMs;
+      _maxUrgentLatencyMs = max(_maxUrgentLatencyMs, _lastUrgentLatencyMs);
+      Serial.printf("Urgent upload latency: %lu ms\n", _lastUrgentLatencyMs);
+    }
+  } else {
     _retryCount = 0;
     _nextAttemptMs = millis();
-    return true;
   }
-
-  backoff();
-  return false;
+  return true;
 }
 
 void NetworkServices::flushQueueTick() {
+  if (hasUrgent()) {
+    if (millis() >= _nextUrgentAttemptMs) sendOne();
+    return;
+  }
   if (millis() < _nextAttemptMs) return;
   sendOne();
 }
@@ -107,7 +609,7 @@ void NetworkServices::flushQueueTick() {
 bool NetworkServices::flushNow(uint16_t maxItems) {
   bool allOk = true;
   for (uint16_t i = 0; i < maxItems; ++i) {
-    if (_accessQueue.empty() && _telemetryQueue.empty()) break;
+    if (_uploads.empty()) break;
     if (!sendOne()) {
       allOk = false;
       break;
@@ -116,110 +618,237 @@ bool NetworkServices::flushNow(uint16_t maxItems) {
   return allOk;
 }
 
-String NetworkServices::doorState() const {
-  return _cachedSolenoidOn ? "UNLOCKING" : "LOCKED";
-}
-
-String NetworkServices::makeTimestampIso8601() const {
-  const time_t now = time(nullptr);
-  if (now <= 0) return String(millis());
-
-  struct tm timeinfo;
-  localtime_r(&now, &timeinfo);
-  char buf[32];
-  strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &timeinfo);
-  return String(buf);
+const char* NetworkServices::doorState() const {
+  return _live.load().solenoidOn ? "UNLOCKING" : "LOCKED";
 }
 
-void NetworkServices::enqueueTelemetry() {
-  if (!_cachedData.valid) return;
+void NetworkServices::enqueueTelemetry(bool urgent) {
+  const LiveState live = _live.load();
+  if (!live.data.valid) return;
 
+  const ConfigSnapshot config = _config->read();
   TelemetryLogPayload payload;
-  payload.timestamp = makeTimestampIso8601();
-  payload.deviceId = _config->data.deviceId;
-  payload.temperatureC = _cachedData.temperature;
-  payload.humidityPct = _cachedData.humidity;
-  payload.fan1On = _cachedFan1On;
-  payload.fan2On = _cachedFan2On;
-  payload.alarmState = _cachedWarning;
-  payload.doorState = doorState();
+  payload.epoch = static_cast<uint32_t>(time(nullptr));
+  strlcpy(payload.deviceId, config->deviceId.c_str(),
+          sizeof(payload.deviceId));
+  payload.fan1On = live.fan1On;
+  payload.fan2On = live.fan2On;
+  payload.alarmState = live.warning;
+  payload.doorState = live.solenoidOn ? "UNLOCKING" : "LOCKED";
   payload.wifiRssi = _wifi->getRSSI();
-  payload.warnThreshold = _config->data.warnThresholdC;
-  payload.stage2Threshold = _config->data.stage2ThresholdC;
-  enqueueTelemetryPayload(payload);
+  payload.warnThresholdCenti =
+      static_cast<int16_t>(toCenti(config->warnThresholdC));
+  payload.stage2ThresholdCenti =
+      static_cast<int16_t>(toCenti(config->stage2ThresholdC));
+  payload.sampledAtMs = live.data.sampledAtMs;
+  payload.temperatureCentiSum = live.data.temperatureCenti;
+  payload.humidityCentiSum = live.data.humidityCenti;
+  payload.temperatureMinCenti = payload.temperatureMaxCenti =
+      live.data.temperatureCenti;
+  payload.humidityMinCenti = payload.humidityMaxCenti = live.data.humidityCenti;
+  payload.fan1OnCount = payload.fan1On ? 1 : 0;
+  payload.fan2OnCount = payload.fan2On ? 1 : 0;
+
+  enqueueUpload(urgent ? UploadClass::Urgent : UploadClass::Telemetry,
+                UploadItem{payload, millis()});
 }
 
-void NetworkServices::setupRoutes() {
-  _server.on("/", HTTP_GET,
-             [this](AsyncWebServerRequest* request) { handleRoot(request); });
+// One handler serves the whole route table: a trie walk replaces the chain
+// of per-route handlers and the prefix checks that used to sit in
+// onNotFound.
+class NetworkServices::RouteDispatcher : public AsyncWebHandler {
+ public:
+  explicit RouteDispatcher(NetworkServices* owner) : _owner(owner) {}
 
-  _server.on("/setup", HTTP_GET, [](AsyncWebServerRequest* request) {
-    request->send(200, "text/html", WebPage::SETUP_HTML);
-  });
+  bool canHandle(AsyncWebServerRequest* request) const override {
+    RouteParams params;
+    return findRoute(request, params) != Routes::Trie::NONE;
+  }
 
-  _server.on("/api/state", HTTP_GET, [this](AsyncWebServerRequest* request) {
-    handleGetState(request);
-  });
+  bool isRequestHandlerTrivial() const override { return false; }
 
-  _server.on("/api/config/thermal", HTTP_GET,
-             [this](AsyncWebServerRequest* request) {
-               handleGetThermalConfig(request);
-             });
-  AsyncCallbackJsonWebHandler* thermalConfigHandler =
-      new AsyncCallbackJsonWebHandler(
-          "/api/config/thermal",
-          [this](AsyncWebServerRequest* request, JsonVariant& json) {
-            handleSetThermalConfig(request, json);
-          });
-  _server.addHandler(thermalConfigHandler);
-
-  _server.on("/api/config/security", HTTP_GET,
-             [this](AsyncWebServerRequest* request) {
-               handleGetSecurityConfig(request);
-             });
-  AsyncCallbackJsonWebHandler* securityConfigHandler =
-      new AsyncCallbackJsonWebHandler(
-          "/api/config/security",
-          [this](AsyncWebServerRequest* request, JsonVariant& json) {
-            handleSetSecurityConfig(request, json);
-          });
-  _server.addHandler(securityConfigHandler);
-
-  _server.on("/api/users", HTTP_GET, [this](AsyncWebServerRequest* request) {
-    handleGetUsers(request);
-  });
-  AsyncCallbackJsonWebHandler* usersHandler = new AsyncCallbackJsonWebHandler(
-      "/api/users", [this](AsyncWebServerRequest* request, JsonVariant& json) {
-        handleUpsertUser(request, json);
-      });
-  _server.addHandler(usersHandler);
+  void handleBody(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                  size_t index, size_t total) override {
+    RouteParams params;
+    const auto found = findRoute(request, params);
+    if (found >= Routes::Trie::WRONG_METHOD) return;
+    const RouteDef& def = Routes::TABLE[found];
+    if (def.body == RouteBody::Stream) {
+      _owner->streamBody(def.route, request, data, len, index, total);
+      return;
+    }
+    // Buffered like AsyncCallbackJsonWebHandler: the request frees
+    // _tempObject with free() when it is destroyed.
+    if (def.body != RouteBody::Json || total > JSON_BODY_MAX) return;
+    if (index == 0) request->_tempObject = malloc(total + 1);
+    if (request->_tempObject == nullptr) return;
+    auto* buf = static_cast<char*>(request->_tempObject);
+    memcpy(buf + index, data, len);
+    if (index + len == total) buf[total] = '\0';
+  }
 
-  _server.on("/api/send", HTTP_POST, [this](AsyncWebServerRequest* request) {
-    handleSendNow(request);
-  });
+  void handleRequest(AsyncWebServerRequest* request) override {
+    RouteParams params;
+    const uint32_t startCycles = ESP.getCycleCount();
+    const auto found = findRoute(request, params);
+    const uint64_t cycles = ESP.getCycleCount() - startCycles;
+    Metrics::observeDispatch(
+        static_cast<uint32_t>(cycles * 1000 / ESP.getCpuFreqMHz()));
 
-  _server.onNotFound([this](AsyncWebServerRequest* request) {
-    if (request->method() == HTTP_DELETE &&
-        request->url().startsWith("/api/users/")) {
-      handleDeleteUser(request);
+    const unsigned long startUs = micros();
+    if (found >= Routes::Trie::WRONG_METHOD) {
+      request->send(405, "application/json",
+                    "{\"error\":\"method not allowed\"}");
+      Metrics::observeRoute(Metrics::Route::NotFound, micros() - startUs);
       return;
     }
+    const RouteDef& def = Routes::TABLE[found];
+    TRACE_SCOPE(Metrics::routeName(def.route));
+    JsonDocument doc;
+    if (def.body == RouteBody::Json && !parseBody(request, doc)) {
+      request->send(request->contentLength() > JSON_BODY_MAX ? 413 : 400,
+                    "application/json", "{\"error\":\"invalid JSON body\"}");
+    } else {
+      JsonVariant json = doc.as<JsonVariant>();
+      _owner->dispatch(def.route, request, params, json);
+    }
+    Metrics::observeRoute(def.route, micros() - startUs);
+  }
+
+ private:
+  static constexpr size_t JSON_BODY_MAX = 4096;
+  NetworkServices* _owner;
+
+  static bool parseBody(AsyncWebServerRequest* request, JsonDocument& doc) {
+    if (request->_tempObject == nullptr) return false;
+    const DeserializationError err =
+        deserializeJson(doc, static_cast<const char*>(request->_tempObject));
+    return !err;
+  }
+};
+
+void NetworkServices::setupRoutes() {
+  _server.addHandler(&_wifiEvents);
+  _server.addHandler(new RouteDispatcher(this));
+  _server.onNotFound([](AsyncWebServerRequest* request) {
+    const unsigned long startUs = micros();
     request->send(404, "application/json", "{\"error\":\"Not found\"}");
+    Metrics::observeRoute(Metrics::Route::NotFound, micros() - startUs);
   });
 }
 
-void NetworkServices::setupWiFiRoutes() {
-  _server.on("/api/wifi/scan", HTTP_GET,
-             [this](AsyncWebServerRequest* request) {
-               handleWiFiScan(request);
-             });
+void NetworkServices::dispatch(Metrics::Route route,
+                               AsyncWebServerRequest* request,
+                               const RouteParams& params, JsonVariant& json) {
+  using Metrics::Route;
+  switch (route) {
+    case Route::Root:
+      handleRoot(request);
+      break;
+    case Route::Setup:
+      request->send(200, "text/html", WebPage::SETUP_HTML);
+      break;
+    case Route::State:
+      handleGetState(request);
+      break;
+    case Route::Batch:
+      handleBatch(request);
+      break;
+    case Route::ConfigSchema:
+      handleConfigSchema(request);
+      break;
+    case Route::ThermalGet:
+      handleGetConfig(request, ConfigGroup::Thermal);
+      break;
+    case Route::ThermalSet:
+      handleSetConfig(request, json, ConfigGroup::Thermal);
+      break;
+    case Route::SecurityGet:
+      handleGetConfig(request, ConfigGroup::Security);
+      break;
+    case Route::SecuritySet:
+      handleSetConfig(request, json, ConfigGroup::Security);
+      break;
+    case Route::UsersGet:
+      handleGetUsers(request);
+      break;
+    case Route::UsersUpsert:
+      handleUpsertUser(request, json);
+      break;
+    case Route::UsersDelete:
+      handleDeleteUser(request,
+                       String(params.text[0].data(), params.text[0].size()));
+      break;
+    case Route::UsersImport:
+      handleImportUsers(request);
+      break;
+    case Route::UsersExport:
+      handleExportUsers(request);
+      break;
+    case Route::SendNow:
+      handleSendNow(request);
+      break;
+    case Route::AccessLog:
+      handleAccessLog(request);
+      break;
+    case Route::Export:
+      handleExport(request);
+      break;
+    case Route::WiFiScan:
+      handleWiFiScan(request);
+      break;
+    case Route::WiFiConnect:
+      handleWiFiConnect(request, json);
+      break;
+    case Route::WiFiJob:
+      handleWiFiJob(request, params.count > 0 ? params.number[0] : 0);
+      break;
+    case Route::Metrics:
+      handleMetrics(request);
+      break;
+    case Route::Trace:
+      handleTrace(request);
+      break;
+    case Route::Profile:
+      handleProfile(request);
+      break;
+    case Route::Heap:
+      handleHeap(request);
+      break;
+    case Route::NotFound:
+    case Route::Count:
+      request->send(404, "application/json", "{\"error\":\"Not found\"}");
+      break;
+  }
+}
+
+void NetworkServices::streamBody(Metrics::Route route,
+                                 AsyncWebServerRequest* request,
+                                 uint8_t* data, size_t len, size_t index,
+                                 size_t total) {
+  if (route == Metrics::Route::UsersImport) {
+    handleImportBody(request, data, len, index, total);
+  }
+}
 
-  AsyncCallbackJsonWebHandler* wifiHandler = new AsyncCallbackJsonWebHandler(
-      "/api/wifi/connect",
-      [this](AsyncWebServerRequest* request, JsonVariant& json) {
-        handleWiFiConnect(request, json);
+void NetworkServices::setupAdmission() {
+  _server.addMiddleware(
+      [](AsyncWebServerRequest* request, ArMiddlewareNext next) {
+        // The SSE stream stays open for as long as the page does, so it is
+        // rate limited but never holds an in-flight slot.
+        const bool stream = request->url() == "/api/wifi/events";
+        AsyncClient* client = request->client();
+        const uint32_t ip =
+            client != nullptr ? static_cast<uint32_t>(client->remoteIP()) : 0;
+        const AdmissionDecision decision =
+            Admission::admit(ip, requestCost(request), !stream);
+        if (decision.verdict != AdmissionVerdict::Admitted) {
+          rejectRequest(request, decision);
+          return;
+        }
+        if (!stream) request->onDisconnect([]() { Admission::release(); });
+        next();
       });
-  _server.addHandler(wifiHandler);
 }
 
 void NetworkServices::handleRoot(AsyncWebServerRequest* request) {
@@ -231,108 +860,353 @@ void NetworkServices::handleRoot(AsyncWebServerRequest* request) {
 }
 
 void NetworkServices::handleGetState(AsyncWebServerRequest* request) {
-  JsonDocument doc;
-  doc["temperature"] = _cachedData.temperature;
-  doc["humidity"] = _cachedData.humidity;
-  doc["valid"] = _cachedData.valid;
-  doc["fan1On"] = _cachedFan1On;
-  doc["fan2On"] = _cachedFan2On;
-  doc["alarm"] = _cachedWarning;
-  doc["doorState"] = doorState();
-  doc["solenoidOn"] = _cachedSolenoidOn;
+  RequestArena* arena = arenaFor(request);
+  JsonDocument doc(arena);
+  fillState(doc.to<JsonObject>());
+  sendJson(request, arena, doc);
+}
+
+void NetworkServices::fillState(JsonObject doc) {
+  const LiveState live = _live.load();
+  doc["temperature"] = live.data.temperatureCenti / 100.0;
+  doc["humidity"] = live.data.humidityCenti / 100.0;
+  doc["valid"] = live.data.valid;
+  doc["fan1On"] = live.fan1On;
+  doc["fan2On"] = live.fan2On;
+  doc["alarm"] = live.warning;
+  doc["doorState"] = live.solenoidOn ? "UNLOCKING" : "LOCKED";
+  doc["solenoidOn"] = live.solenoidOn;
   doc["lockoutActive"] = _access->isLockoutActive();
   doc["lockoutRemainingSec"] = _access->lockoutRemainingSec();
   doc["failedAttempts"] = _access->failedAttempts();
   doc["accessMessage"] = _access->lastMessage();
-  doc["queueTelemetry"] = _telemetryQueue.size();
-  doc["queueAccess"] = _accessQueue.size();
+  doc["queueTelemetry"] = _uploads.size(UploadClass::Telemetry);
+  doc["queueAccess"] = _uploads.size(UploadClass::Access);
+  doc["queueUrgent"] = _uploads.size(UploadClass::Urgent);
+  doc["urgentLatencyMs"] = _lastUrgentLatencyMs;
+  doc["urgentLatencyMaxMs"] = _maxUrgentLatencyMs;
+  JsonObject uploads = doc["uploads"].to<JsonObject>();
+  for (size_t i = 0; i < UploadScheduler::CLASS_COUNT; ++i) {
+    const auto cls = static_cast<UploadClass>(i);
+    const LatencyPercentiles pct = _uploads.percentiles(cls);
+    JsonObject item =
+        uploads[UploadScheduler::className(cls)].to<JsonObject>();
+    item["queued"] = _uploads.size(cls);
+    item["dropped"] = _uploads.dropped(cls);
+    item["coalesced"] = _uploads.coalesced(cls);
+    item["samples"] = pct.samples;
+    item["p50Ms"] = pct.p50;
+    item["p90Ms"] = pct.p90;
+    item["p99Ms"] = pct.p99;
+    item["maxMs"] = pct.max;
+  }
   doc["wifiConnected"] = _wifi->isConnected();
   doc["ssid"] = _wifi->getSSID();
   doc["rssi"] = _wifi->getRSSI();
-  doc["deviceId"] = _config->data.deviceId;
+  doc["deviceId"] = _config->read()->deviceId;
   doc["lastSend"] = _lastSendEpoch;
-
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
 }
 
-void NetworkServices::handleGetThermalConfig(AsyncWebServerRequest* request) {
-  JsonDocument doc;
-  doc["warnThreshold"] = _config->data.warnThresholdC;
-  doc["stage2Threshold"] = _config->data.stage2ThresholdC;
-  doc["fan1BaselineOn"] = _config->data.fan1BaselineOn;
-  doc["sensorReadIntervalSec"] = _config->data.sensorReadIntervalSec;
-  doc["cloudSendIntervalSec"] = _config->data.cloudSendIntervalSec;
+void NetworkServices::handleBatch(AsyncWebServerRequest* request) {
+  BatchPart parts[BATCH_MAX_PARTS];
+  size_t count = 0;
+  char unknown[24] = "";
+  const String list =
+      request->hasParam("r") ? request->getParam("r")->value() : "";
+  if (!parseBatch(list, parts, count, unknown, sizeof(unknown)) ||
+      count == 0) {
+    char body[80];
+    snprintf(body, sizeof(body),
+             "{\"error\":\"unknown part\",\"part\":\"%s\"}", unknown);
+    request->send(400, "application/json", body);
+    return;
+  }
 
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  RequestArena* arena = arenaFor(request);
+  JsonDocument doc(arena);
+  // Read before the parts so the tag is never newer than the data sent.
+  char etag[ETAG_SIZE];
+  formatEtag(etag, sizeof(etag), _config->read()->version);
+  doc["configEtag"] = etag;
+  for (size_t i = 0; i < count; ++i) {
+    JsonObject out =
+        doc[BATCH_PART_NAMES[static_cast<size_t>(parts[i])]].to<JsonObject>();
+    switch (parts[i]) {
+      case BatchPart::State:
+        fillState(out);
+        break;
+      case BatchPart::Schema:
+        ConfigSchema::describe(out);
+        break;
+      case BatchPart::Thermal:
+        ConfigSchema::toApi(*_config->read(), ConfigGroup::Thermal, out);
+        break;
+      case BatchPart::Security:
+        ConfigSchema::toApi(*_config->read(), ConfigGroup::Security, out);
+        break;
+      case BatchPart::Users:
+        fillUsers(*_config->read(), out);
+        break;
+      case BatchPart::WiFi:
+        fillWiFiScan(out);
+        break;
+      case BatchPart::Count:
+        break;
+    }
+  }
+  sendJson(request, arena, doc);
 }
 
-void NetworkServices::handleSetThermalConfig(AsyncWebServerRequest* request,
-                                             JsonVariant& json) {
-  JsonObject obj = json.as<JsonObject>();
-  if (obj["warnThreshold"].is<float>()) {
-    _config->data.warnThresholdC = obj["warnThreshold"].as<float>();
+void NetworkServices::handleMetrics(AsyncWebServerRequest* request) {
+  bool expected = false;
+  if (!s_metricsBusy.compare_exchange_strong(expected, true)) {
+    request->send(503, "text/plain", "scrape in progress");
+    return;
   }
-  if (obj["stage2Threshold"].is<float>()) {
-    _config->data.stage2ThresholdC = obj["stage2Threshold"].as<float>();
+
+  MetricsWriter out(s_metricsBuffer, sizeof(s_metricsBuffer));
+  out.family("smartserver_heap_free_bytes", "gauge", "Current free heap");
+  out.sample("smartserver_heap_free_bytes", nullptr, ESP.getFreeHeap());
+  out.family("smartserver_heap_min_free_bytes", "gauge",
+             "Lowest free heap since boot");
+  out.sample("smartserver_heap_min_free_bytes", nullptr, ESP.getMinFreeHeap());
+  out.family("smartserver_heap_largest_block_bytes", "gauge",
+             "Largest allocatable heap block");
+  out.sample("smartserver_heap_largest_block_bytes", nullptr,
+             ESP.getMaxAllocHeap());
+
+  char labels[32];
+  out.family("smartserver_upload_queue_depth", "gauge",
+             "Pending uploads by class");
+  for (size_t i = 0; i < UploadScheduler::CLASS_COUNT; ++i) {
+    const auto cls = static_cast<UploadClass>(i);
+    snprintf(labels, sizeof(labels), "class=\"%s\"",
+             UploadScheduler::className(cls));
+    out.sample("smartserver_upload_queue_depth", labels, _uploads.size(cls));
   }
-  if (obj["fan1BaselineOn"].is<bool>()) {
-    _config->data.fan1BaselineOn = obj["fan1BaselineOn"].as<bool>();
+
+  out.family("smartserver_wifi_connected", "gauge", "1 when STA is online");
+  out.sample("smartserver_wifi_connected", nullptr, _wifi->isConnected());
+  out.family("smartserver_wifi_rssi_dbm", "gauge", "Current STA RSSI");
+  out.sample("smartserver_wifi_rssi_dbm", nullptr, _wifi->getRSSI());
+  out.family("smartserver_wifi_reconnects_total", "counter",
+             "STA link losses since boot");
+  out.sample("smartserver_wifi_reconnects_total", nullptr,
+             _wifi->reconnectCount());
+  out.family("smartserver_access_events_total", "counter",
+             "Access events seen on the event bus by type");
+  for (size_t i = 0; i < _accessEventCounts.size(); ++i) {
+    snprintf(labels, sizeof(labels), "type=\"%s\"",
+             accessResultName(static_cast<AccessEventType>(i)));
+    out.sample("smartserver_access_events_total", labels,
+               _accessEventCounts[i].load());
   }
-  if (obj["sensorReadIntervalSec"].is<uint32_t>()) {
-    _config->data.sensorReadIntervalSec =
-        max<uint32_t>(obj["sensorReadIntervalSec"].as<uint32_t>(), 1);
-    _sensors->setReadIntervalMs(_config->data.sensorReadIntervalSec * 1000UL);
+  out.family("smartserver_event_bus_missed_total", "counter",
+             "Events overwritten before a subscriber read them");
+  out.sample("smartserver_event_bus_missed_total", "subscriber=\"upload\"",
+             _uploadEvents.missed);
+  out.sample("smartserver_event_bus_missed_total", "subscriber=\"metrics\"",
+             _metricsEvents.missed);
+  out.sample("smartserver_event_bus_missed_total", "subscriber=\"audit\"",
+             _auditEvents.missed);
+
+  out.family("smartserver_http_admission_total", "counter",
+             "Web requests by admission verdict");
+  for (size_t i = 0; i < Admission::VERDICT_COUNT; ++i) {
+    const auto verdict = static_cast<AdmissionVerdict>(i);
+    snprintf(labels, sizeof(labels), "verdict=\"%s\"",
+             Admission::verdictName(verdict));
+    out.sample("smartserver_http_admission_total", labels,
+               Admission::verdictCount(verdict));
   }
-  if (obj["cloudSendIntervalSec"].is<uint32_t>()) {
-    _config->data.cloudSendIntervalSec =
-        max<uint32_t>(obj["cloudSendIntervalSec"].as<uint32_t>(), 10);
+  const AdmissionStats admission = Admission::stats();
+  out.family("smartserver_http_in_flight", "gauge",
+             "Admitted web requests whose connection is still open");
+  out.sample("smartserver_http_in_flight", "", admission.inFlight);
+  out.family("smartserver_http_in_flight_high_water", "gauge",
+             "Most web requests open at once since boot");
+  out.sample("smartserver_http_in_flight_high_water", "",
+             admission.inFlightHighWater);
+
+  out.family("smartserver_route_table", "gauge",
+             "Dispatcher route table and trie size");
+  out.sample("smartserver_route_table", "kind=\"routes\"",
+             Routes::TABLE.size());
+  out.sample("smartserver_route_table", "kind=\"trie_nodes\"",
+             Routes::TRIE.nodeCount());
+
+  out.family("smartserver_audit_log_records", "gauge",
+             "Access records retained in the on-device audit log");
+  out.sample("smartserver_audit_log_records", "",
+             _auditLog.nextSeq() - _auditLog.firstSeq());
+  out.family("smartserver_audit_log_write_errors_total", "counter",
+             "Audit log appends that failed to reach flash");
+  out.sample("smartserver_audit_log_write_errors_total", "",
+             _auditLog.writeErrors());
+  out.family("smartserver_sensor_history_records", "gauge",
+             "Sensor samples retained in the on-device history");
+  out.sample("smartserver_sensor_history_records", "",
+             _history.nextSeq() - _history.firstSeq());
+  out.family("smartserver_sensor_history_write_errors_total", "counter",
+             "Sensor history appends that failed to reach flash");
+  out.sample("smartserver_sensor_history_write_errors_total", "",
+             _history.writeErrors());
+
+  out.family("smartserver_keypad_events_dropped_total", "counter",
+             "Key events lost because the keypad queue was full");
+  out.sample("smartserver_keypad_events_dropped_total", nullptr,
+             _access->keyEventsDropped());
+  out.family("smartserver_sht21_errors_total", "counter",
+             "Failed SHT21 reads since boot");
+  out.sample("smartserver_sht21_errors_total", nullptr, _sensors->errorCount());
+
+  out.family("smartserver_heap_tag_live_bytes", "gauge",
+             "Tracked live heap bytes by subsystem");
+  for (size_t i = 0; i < HeapTracker::TAG_COUNT; ++i) {
+    const auto tag = static_cast<HeapTag>(i);
+    snprintf(labels, sizeof(labels), "tag=\"%s\"", HeapTracker::tagName(tag));
+    out.sample("smartserver_heap_tag_live_bytes", labels,
+               HeapTracker::stats(tag).liveBytes);
   }
-  _config->save();
-  request->send(200, "application/json", "{\"success\":true}");
+
+  const RequestArenaStats arenas = RequestArena::stats();
+  out.family("smartserver_request_arenas_in_use", "gauge",
+             "Request arenas currently leased");
+  out.sample("smartserver_request_arenas_in_use", nullptr, arenas.inUse);
+  out.family("smartserver_request_arena_high_water_bytes", "gauge",
+             "Largest arena footprint of a single request");
+  out.sample("smartserver_request_arena_high_water_bytes", nullptr,
+             arenas.highWaterBytes);
+  out.family("smartserver_request_arena_acquired_total", "counter",
+             "Requests that asked for an arena");
+  out.sample("smartserver_request_arena_acquired_total", nullptr,
+             arenas.acquired);
+  out.family("smartserver_request_arena_exhausted_total", "counter",
+             "Requests served from the heap because every arena was leased");
+  out.sample("smartserver_request_arena_exhausted_total", nullptr,
+             arenas.exhausted);
+  out.family("smartserver_request_arena_spills_total", "counter",
+             "Allocations that overflowed an arena onto the heap");
+  out.sample("smartserver_request_arena_spills_total", nullptr,
+             arenas.heapSpills);
+
+  Metrics::writeCollected(out);
+  if (out.truncated()) Serial.println(F("Metrics output truncated"));
+
+  onAdmittedDisconnect(request, []() { s_metricsBusy = false; });
+  request->send(request->beginResponse(
+      200, "text/plain; version=0.0.4",
+      reinterpret_cast<const uint8_t*>(s_metricsBuffer), out.length()));
 }
 
-void NetworkServices::handleGetSecurityConfig(AsyncWebServerRequest* request) {
-  JsonDocument doc;
-  doc["maxFail"] = _config->data.maxFailedAttempts;
-  doc["lockoutSecs"] = _config->data.keypadLockoutSec;
-  doc["unlockSecs"] = _config->data.solenoidUnlockSec;
-  doc["deviceId"] = _config->data.deviceId;
+void NetworkServices::handleHeap(AsyncWebServerRequest* request) {
+  RequestArena* arena = arenaFor(request);
+  JsonDocument doc(arena);
+  doc["freeHeap"] = ESP.getFreeHeap();
+  doc["minFreeHeap"] = ESP.getMinFreeHeap();
+  doc["largestBlock"] = ESP.getMaxAllocHeap();
+  JsonObject tags = doc["tags"].to<JsonObject>();
+  for (size_t i = 0; i < HeapTracker::TAG_COUNT; ++i) {
+    const auto tag = static_cast<HeapTag>(i);
+    const HeapTagStats stats = HeapTracker::stats(tag);
+    JsonObject item = tags[HeapTracker::tagName(tag)].to<JsonObject>();
+    item["liveBytes"] = stats.liveBytes;
+    item["peakBytes"] = stats.peakBytes;
+    item["allocCount"] = stats.allocCount;
+  }
+  JsonObject queues = doc["queueHighWater"].to<JsonObject>();
+  for (size_t i = 0; i < HeapTracker::QUEUE_COUNT; ++i) {
+    const auto queue = static_cast<HeapQueue>(i);
+    queues[HeapTracker::queueName(queue)] = HeapTracker::queueHighWater(queue);
+  }
+  sendJson(request, arena, doc);
+}
 
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+void NetworkServices::handleTrace(AsyncWebServerRequest* request) {
+  auto exporter = std::make_shared<Trace::ChromeExporter>();
+  request->send(request->beginChunkedResponse(
+      "application/json", [exporter](uint8_t* buf, size_t maxLen, size_t) {
+        return exporter->fill(buf, maxLen);
+      }));
 }
 
-void NetworkServices::handleSetSecurityConfig(AsyncWebServerRequest* request,
-                                              JsonVariant& json) {
-  JsonObject obj = json.as<JsonObject>();
-  if (obj["maxFail"].is<uint8_t>()) {
-    _config->data.maxFailedAttempts =
-        max<uint8_t>(obj["maxFail"].as<uint8_t>(), 1);
+void NetworkServices::handleProfile(AsyncWebServerRequest* request) {
+  if (request->hasParam("reset")) {
+    Profiler::reset();
+    request->send(200, "application/json", "{\"success\":true}");
+    return;
   }
-  if (obj["lockoutSecs"].is<uint32_t>()) {
-    _config->data.keypadLockoutSec =
-        max<uint32_t>(obj["lockoutSecs"].as<uint32_t>(), 10);
+  auto exporter = std::make_shared<Profiler::TextExporter>();
+  request->send(request->beginChunkedResponse(
+      "text/plain", [exporter](uint8_t* buf, size_t maxLen, size_t) {
+        return exporter->fill(buf, maxLen);
+      }));
+}
+
+void NetworkServices::handleGetConfig(AsyncWebServerRequest* request,
+                                      ConfigGroup group) {
+  const ConfigSnapshot config = _config->read();
+  char etag[ETAG_SIZE];
+  formatEtag(etag, sizeof(etag), config->version);
+  if (sendNotModified(request, etag)) return;
+
+  RequestArena* arena = arenaFor(request);
+  JsonDocument doc(arena);
+  ConfigSchema::toApi(*config, group, doc.to<JsonObject>());
+  sendJson(request, arena, doc, etag);
+}
+
+void NetworkServices::handleSetConfig(AsyncWebServerRequest* request,
+                                      JsonVariant& json, ConfigGroup group) {
+  bool stale = false;
+  const ConfigManager::Precondition precondition = ifMatch(request, stale);
+  const JsonObjectConst obj = json.as<JsonObjectConst>();
+  const char* rejected = nullptr;
+  _config->update([&](AppConfig& data) {
+    if (!precondition(data)) return false;
+    rejected = ConfigSchema::fromApi(obj, group, data);
+    return rejected == nullptr;
+  });
+  if (stale) {
+    sendPreconditionFailed(request, _config->read()->version);
+    return;
   }
-  if (obj["unlockSecs"].is<uint32_t>()) {
-    _config->data.solenoidUnlockSec =
-        max<uint32_t>(obj["unlockSecs"].as<uint32_t>(), 1);
+  if (rejected != nullptr) {
+    char body[96];
+    snprintf(body, sizeof(body),
+             "{\"error\":\"invalid field\",\"field\":\"%s\"}", rejected);
+    request->send(400, "application/json", body);
+    return;
   }
-  if (obj["deviceId"].is<const char*>()) {
-    _config->data.deviceId = obj["deviceId"].as<String>();
+  const ConfigSnapshot config = _config->read();
+  if (group == ConfigGroup::Thermal) {
+    _sensors->setReadIntervalMs(config->sensorReadIntervalSec * 1000UL);
   }
-  _config->save();
-  request->send(200, "application/json", "{\"success\":true}");
+  sendSaved(request, config->version);
+}
+
+void NetworkServices::handleConfigSchema(AsyncWebServerRequest* request) {
+  RequestArena* arena = arenaFor(request);
+  JsonDocument doc(arena);
+  ConfigSchema::describe(doc.to<JsonObject>());
+  sendJson(request, arena, doc);
 }
 
 void NetworkServices::handleGetUsers(AsyncWebServerRequest* request) {
-  JsonDocument doc;
+  const ConfigSnapshot config = _config->read();
+  char etag[ETAG_SIZE];
+  formatEtag(etag, sizeof(etag), config->version);
+  if (sendNotModified(request, etag)) return;
+
+  RequestArena* arena = arenaFor(request);
+  JsonDocument doc(arena);
+  fillUsers(*config, doc.to<JsonObject>());
+  sendJson(request, arena, doc, etag);
+}
+
+void NetworkServices::fillUsers(const AppConfig& config, JsonObject doc) {
   JsonArray users = doc["users"].to<JsonArray>();
-  for (const auto& user : _config->data.users) {
+  for (const auto& user : config.users) {
     if (user.userId.length() == 0) continue;
     JsonObject item = users.add<JsonObject>();
     item["userId"] = user.userId;
@@ -340,10 +1214,6 @@ void NetworkServices::handleGetUsers(AsyncWebServerRequest* request) {
     item["enabled"] = user.enabled;
   }
   doc["count"] = users.size();
-
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
 }
 
 void NetworkServices::handleUpsertUser(AsyncWebServerRequest* request,
@@ -355,43 +1225,235 @@ void NetworkServices::handleUpsertUser(AsyncWebServerRequest* request,
   const bool enabled = obj["enabled"] | true;
 
   String error;
-  if (!_access->upsertUser(userId, displayName, pin, enabled, error)) {
+  bool stale = false;
+  if (!_access->upsertUser(userId, displayName, pin, enabled, error,
+                           ifMatch(request, stale))) {
+    if (stale) {
+      sendPreconditionFailed(request, _config->read()->version);
+      return;
+    }
     String body = "{\"error\":\"" + error + "\"}";
     request->send(400, "application/json", body);
     return;
   }
 
-  request->send(200, "application/json", "{\"success\":true}");
+  sendSaved(request, _config->read()->version);
 }
 
-void NetworkServices::handleDeleteUser(AsyncWebServerRequest* request) {
-  const String path = request->url();
-  const String userId = path.substring(String("/api/users/").length());
-  if (userId.length() == 0) {
-    request->send(400, "application/json", "{\"error\":\"userId required\"}");
+void NetworkServices::handleImportBody(AsyncWebServerRequest* request,
+                                       uint8_t* data, size_t len,
+                                       size_t index, size_t total) {
+  if (index == 0) {
+    if (_importOwner != nullptr || total > IMPORT_MAX_BYTES) return;
+    _import = std::make_unique<UserImport>();
+    _importOwner = request;
+    _importStartedUs = micros();
+    // Middleware runs once the body is in, so no admission slot is held yet;
+    // if the request is admitted its own callback replaces this one.
+    request->onDisconnect([this, request]() {
+      if (_importOwner == request) {
+        _import.reset();
+        _importOwner = nullptr;
+      }
+    });
+  }
+  if (_importOwner == request) _import->feed(data, len);
+}
+
+void NetworkServices::handleImportUsers(AsyncWebServerRequest* request) {
+  if (request->contentLength() > IMPORT_MAX_BYTES) {
+    request->send(413, "application/json", "{\"error\":\"body too large\"}");
+    return;
+  }
+  if (_importOwner != request) {
+    if (_importOwner != nullptr) {
+      request->send(409, "application/json",
+                    "{\"error\":\"import already running\"}");
+    } else {
+      request->send(400, "application/json", "{\"error\":\"empty body\"}");
+    }
+    return;
+  }
+
+  std::unique_ptr<UserImport> parsed = std::move(_import);
+  _importOwner = nullptr;
+  parsed->finish();
+  const unsigned long parsedUs = micros();
+
+  int code = 200;
+  bool stale = false;
+  size_t created = 0;
+  size_t failed = parsed->userCount();
+  const char* error = nullptr;
+  if (parsed->rejected() > 0) {
+    code = 400;
+    error = "invalid rows";
+  } else if (parsed->userCount() == 0) {
+    code = 400;
+    error = "no users";
+  } else if (!_config->upsertUsers(parsed->users(), parsed->userCount(),
+                                   created, failed, ifMatch(request, stale))) {
+    if (stale) {
+      sendPreconditionFailed(request, _config->read()->version);
+      return;
+    }
+    code = failed < parsed->userCount() ? 409 : 500;
+    error = failed < parsed->userCount() ? "no slot or pin for new user"
+                                         : "failed to save users";
+  }
+  const unsigned long doneUs = micros();
+
+  RequestArena* arena = arenaFor(request);
+  JsonDocument doc(arena);
+  doc["success"] = code == 200;
+  if (error != nullptr) doc["error"] = error;
+  doc["lines"] = parsed->lines();
+  doc["bytes"] = parsed->bytes();
+  doc["rejected"] = parsed->rejected();
+  JsonArray errors = doc["errors"].to<JsonArray>();
+  for (size_t i = 0; i < parsed->errorCount(); ++i) {
+    JsonObject item = errors.add<JsonObject>();
+    item["line"] = parsed->error(i).line;
+    item["error"] = parsed->error(i).reason;
+  }
+  if (code == 409) {
+    JsonObject item = errors.add<JsonObject>();
+    item["line"] = parsed->lineOf(failed);
+    item["error"] = error;
+  }
+  if (code == 200) {
+    const float elapsedSec = (doneUs - _importStartedUs) / 1e6f;
+    doc["imported"] = parsed->userCount();
+    doc["created"] = created;
+    doc["updated"] = parsed->userCount() - created;
+    doc["parseMs"] = (parsedUs - _importStartedUs) / 1000.0f;
+    doc["commitMs"] = (doneUs - parsedUs) / 1000.0f;
+    doc["usersPerSec"] =
+        elapsedSec > 0.0f ? parsed->userCount() / elapsedSec : 0.0f;
+  }
+
+  const size_t len = measureJson(doc);
+  char* buf = arena->allocText(len + 1);
+  if (buf == nullptr) {
+    request->send(code, "application/json", "{\"error\":\"out of memory\"}");
     return;
   }
-  if (!_config->removeUser(userId)) {
+  serializeJson(doc, buf, len + 1);
+  AsyncWebServerResponse* response = request->beginResponse(
+      code, "application/json", reinterpret_cast<const uint8_t*>(buf), len);
+  char etag[ETAG_SIZE];
+  formatEtag(etag, sizeof(etag), _config->read()->version);
+  addEtag(response, code == 200 ? etag : nullptr);
+  request->send(response);
+}
+
+void NetworkServices::handleExportUsers(AsyncWebServerRequest* request) {
+  auto stream = std::make_shared<UserExportStream>();
+  stream->config = _config;
+  stream->csv = request->hasParam("format") &&
+                request->getParam("format")->value() == "csv";
+  request->send(request->beginChunkedResponse(
+      stream->csv ? "text/csv" : "application/x-ndjson",
+      [stream](uint8_t* buf, size_t maxLen, size_t) -> size_t {
+        return pumpText(*stream, buf, maxLen, refillUserExport);
+      }));
+}
+
+void NetworkServices::handleDeleteUser(AsyncWebServerRequest* request,
+                                       const String& userId) {
+  bool stale = false;
+  if (!_config->removeUser(userId, ifMatch(request, stale))) {
+    if (stale) {
+      sendPreconditionFailed(request, _config->read()->version);
+      return;
+    }
     request->send(404, "application/json", "{\"error\":\"user not found\"}");
     return;
   }
-  request->send(200, "application/json", "{\"success\":true}");
+  sendSaved(request, _config->read()->version);
+}
+
+void NetworkServices::handleAccessLog(AsyncWebServerRequest* request) {
+  auto param = [request](const char* name, uint32_t fallback) -> uint32_t {
+    if (!request->hasParam(name)) return fallback;
+    return strtoul(request->getParam(name)->value().c_str(), nullptr, 10);
+  };
+  const String user =
+      request->hasParam("user") ? request->getParam("user")->value() : "";
+
+  auto stream = std::make_shared<AuditStream>();
+  stream->log = &_auditLog;
+  stream->query = _auditLog.makeQuery(param("since", 0),
+                                      param("until", UINT32_MAX), user.c_str(),
+                                      param("cursor", 0));
+  stream->remaining = static_cast<uint16_t>(std::clamp<uint32_t>(
+      param("limit", AUDIT_DEFAULT_LIMIT), 1, AUDIT_MAX_LIMIT));
+
+  request->send(request->beginChunkedResponse(
+      "application/json",
+      [stream](uint8_t* buf, size_t maxLen, size_t) -> size_t {
+        return pumpText(*stream, buf, maxLen, refillAuditStream);
+      }));
+}
+
+void NetworkServices::handleExport(AsyncWebServerRequest* request) {
+  auto param = [request](const char* name) -> String {
+    return request->hasParam(name) ? request->getParam(name)->value() : "";
+  };
+  ExportKind kind = ExportKind::Telemetry;
+  ExportFormat format = ExportFormat::Csv;
+  if (!DataExport::parseKind(param("kind"), kind) ||
+      (request->hasParam("format") &&
+       !DataExport::parseFormat(param("format"), format))) {
+    request->send(400, "application/json",
+                  "{\"error\":\"kind=telemetry|access, format=csv|bin\"}");
+    return;
+  }
+  const uint32_t from =
+      request->hasParam("from") ? strtoul(param("from").c_str(), nullptr, 10)
+                                : 0;
+  const uint32_t to = request->hasParam("to")
+                          ? strtoul(param("to").c_str(), nullptr, 10)
+                          : UINT32_MAX;
+  if (from > to) {
+    request->send(400, "application/json", "{\"error\":\"from > to\"}");
+    return;
+  }
+
+  const bool csv = format == ExportFormat::Csv;
+  auto exporter = std::make_shared<DataExport>(kind, format, from, to,
+                                               _history, _auditLog);
+  AsyncWebServerResponse* response = request->beginChunkedResponse(
+      csv ? "text/csv" : "application/octet-stream",
+      [exporter](uint8_t* buf, size_t maxLen, size_t) -> size_t {
+        return exporter->fill(buf, maxLen);
+      });
+  char disposition[48];
+  snprintf(disposition, sizeof(disposition), "attachment; filename=\"%s.%s\"",
+           DataExport::kindName(kind), csv ? "csv" : "bin");
+  response->addHeader("Content-Disposition", disposition);
+  request->send(response);
 }
 
 void NetworkServices::handleSendNow(AsyncWebServerRequest* request) {
   const bool ok = flushNow(50);
-  JsonDocument doc;
+  RequestArena* arena = arenaFor(request);
+  JsonDocument doc(arena);
   doc["success"] = ok;
-  doc["queueTelemetry"] = _telemetryQueue.size();
-  doc["queueAccess"] = _accessQueue.size();
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  doc["queueTelemetry"] = _uploads.size(UploadClass::Telemetry);
+  doc["queueAccess"] = _uploads.size(UploadClass::Access);
+  sendJson(request, arena, doc);
 }
 
 void NetworkServices::handleWiFiScan(AsyncWebServerRequest* request) {
+  RequestArena* arena = arenaFor(request);
+  JsonDocument doc(arena);
+  fillWiFiScan(doc.to<JsonObject>());
+  sendJson(request, arena, doc);
+}
+
+void NetworkServices::fillWiFiScan(JsonObject doc) {
   auto networks = _wifi->getScannedNetworks();
-  JsonDocument doc;
   JsonArray arr = doc["networks"].to<JsonArray>();
   for (const auto& net : networks) {
     JsonObject obj = arr.add<JsonObject>();
@@ -400,9 +1462,6 @@ void NetworkServices::handleWiFiScan(AsyncWebServerRequest* request) {
     obj["open"] = net.open;
     obj["saved"] = net.saved;
   }
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
 }
 
 void NetworkServices::handleWiFiConnect(AsyncWebServerRequest* request,
@@ -416,24 +1475,31 @@ void NetworkServices::handleWiFiConnect(AsyncWebServerRequest* request,
     return;
   }
 
+  const uint32_t jobId = _wifi->requestConnect(ssid, password);
+  if (jobId == 0) {
+    request->send(409, "application/json",
+                  "{\"error\":\"connect already in progress\"}");
+    return;
+  }
   _config->addWiFi(ssid, password);
 
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid.c_str(), password.c_str());
-  unsigned long start = millis();
-  while (WiFi.status() != WL_CONNECTED && millis() - start < 15000) {
-    delay(500);
-  }
+  char body[48];
+  snprintf(body, sizeof(body), "{\"jobId\":%lu,\"state\":\"queued\"}",
+           static_cast<unsigned long>(jobId));
+  request->send(202, "application/json", body);
+}
 
-  JsonDocument doc;
-  if (WiFi.status() == WL_CONNECTED) {
-    doc["success"] = true;
-    doc["ip"] = WiFi.localIP().toString();
-  } else {
-    doc["success"] = false;
-    doc["error"] = "Connection failed";
+void NetworkServices::handleWiFiJob(AsyncWebServerRequest* request,
+                                    uint32_t jobId) {
+  if (jobId == 0 && request->hasParam("id")) {
+    jobId = strtoul(request->getParam("id")->value().c_str(), nullptr, 10);
+  }
+  const ConnectJob job = _wifi->connectJob();
+  if (job.id == 0 || (jobId != 0 && jobId != job.id)) {
+    request->send(404, "application/json", "{\"error\":\"job not found\"}");
+    return;
   }
-  String response;
-  serializeJson(doc, response);
-  request->send(200, "application/json", response);
+  char body[160];
+  serializeWiFiJob(job, body, sizeof(body));
+  request->send(200, "application/json", body);
 }
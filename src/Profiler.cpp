@@ -0,0 +1,193 @@
+#include "Profiler.h"
+
+#if PROFILER_ENABLED
+
+#include <esp_freertos_hooks.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <xtensa_context.h>
+
+namespace {
+static_assert((PROFILER_TABLE_SIZE & (PROFILER_TABLE_SIZE - 1)) == 0,
+              "PROFILER_TABLE_SIZE must be a power of two");
+constexpr uint32_t TABLE_MASK = PROFILER_TABLE_SIZE - 1;
+constexpr size_t MAX_TASKS = 16;
+constexpr uint32_t SAMPLE_HZ = configTICK_RATE_HZ;
+
+struct SampleSlot {
+  uint32_t pc;
+  uint32_t caller;
+  uint16_t count;
+  uint8_t task;
+};
+
+struct TaskSlot {
+  TaskHandle_t handle;
+  uint32_t samples;
+};
+
+SampleSlot s_samples[PROFILER_TABLE_SIZE];
+TaskSlot s_tasks[MAX_TASKS];
+uint32_t s_totalSamples = 0;
+uint32_t s_droppedSamples = 0;
+portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+uint32_t returnAddress(uint32_t a0) {
+  return a0 == 0 ? 0 : (a0 & 0x3FFFFFFFu) | 0x40000000u;
+}
+
+uint8_t IRAM_ATTR taskIndex(TaskHandle_t handle) {
+  for (uint8_t i = 0; i < MAX_TASKS; ++i) {
+    if (s_tasks[i].handle == handle) return i;
+    if (s_tasks[i].handle == nullptr) {
+      s_tasks[i].handle = handle;
+      return i;
+    }
+  }
+  return MAX_TASKS - 1;
+}
+
+void IRAM_ATTR sampleCurrentCore() {
+  TaskHandle_t task = xTaskGetCurrentTaskHandleForCore(xPortGetCoreID());
+  if (task == nullptr) return;
+
+  // pxTopOfStack is the first TCB field and points at the interrupted
+  // task's saved exception frame while we are inside the tick ISR.
+  const auto* frame = *reinterpret_cast<XtExcFrame* const*>(task);
+  const uint32_t pc = static_cast<uint32_t>(frame->pc);
+  const uint32_t caller = returnAddress(static_cast<uint32_t>(frame->a0));
+
+  portENTER_CRITICAL_ISR(&s_lock);
+  const uint8_t t = taskIndex(task);
+  ++s_tasks[t].samples;
+  ++s_totalSamples;
+
+  uint32_t h = (pc ^ (caller * 2654435761u)) & TABLE_MASK;
+  bool stored = false;
+  for (uint32_t probe = 0; probe < 8; ++probe) {
+    SampleSlot& slot = s_samples[(h + probe) & TABLE_MASK];
+    if (slot.count == 0) {
+      slot = {pc, caller, 1, t};
+      stored = true;
+      break;
+    }
+    if (slot.pc == pc && slot.caller == caller && slot.task == t) {
+      if (slot.count < UINT16_MAX) ++slot.count;
+      stored = true;
+      break;
+    }
+  }
+  if (!stored) ++s_droppedSamples;
+  portEXIT_CRITICAL_ISR(&s_lock);
+}
+}  // namespace
+
+namespace Profiler {
+
+void begin() {
+  reset();
+  for (int core = 0; core < portNUM_PROCESSORS; ++core) {
+    esp_register_freertos_tick_hook_for_cpu(sampleCurrentCore, core);
+  }
+  Serial.printf("Profiler: sampling %lu Hz per core\n",
+                static_cast<unsigned long>(SAMPLE_HZ));
+}
+
+void reset() {
+  portENTER_CRITICAL(&s_lock);
+  memset(s_samples, 0, sizeof(s_samples));
+  memset(s_tasks, 0, sizeof(s_tasks));
+  s_totalSamples = 0;
+  s_droppedSamples = 0;
+  portEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t totalSamples() { return s_totalSamples; }
+
+TextExporter::TextExporter() {}
+
+bool TextExporter::nextLine() {
+  _lineOffset = 0;
+  _lineLen = 0;
+
+  switch (_stage) {
+    case Stage::Header:
+      _lineLen = snprintf(_line, sizeof(_line),
+                          "# smart-server profile v1\n"
+                          "hz %lu\nsamples %lu\ndropped %lu\n",
+                          static_cast<unsigned long>(SAMPLE_HZ),
+                          static_cast<unsigned long>(s_totalSamples),
+                          static_cast<unsigned long>(s_droppedSamples));
+      _stage = Stage::Tasks;
+      _cursor = 0;
+      return true;
+
+    case Stage::Tasks:
+      while (_cursor < MAX_TASKS) {
+        const size_t i = _cursor++;
+        portENTER_CRITICAL(&s_lock);
+        const TaskSlot slot = s_tasks[i];
+        portEXIT_CRITICAL(&s_lock);
+        if (slot.handle == nullptr) continue;
+        _lineLen = snprintf(_line, sizeof(_line), "task %u %s %lu\n",
+                            static_cast<unsigned>(i),
+                            pcTaskGetName(slot.handle),
+                            static_cast<unsigned long>(slot.samples));
+        return true;
+      }
+      _stage = Stage::Samples;
+      _cursor = 0;
+      [[fallthrough]];
+
+    case Stage::Samples:
+      while (_cursor < PROFILER_TABLE_SIZE) {
+        const size_t i = _cursor++;
+        portENTER_CRITICAL(&s_lock);
+        const SampleSlot slot = s_samples[i];
+        portEXIT_CRITICAL(&s_lock);
+        if (slot.count == 0) continue;
+        _lineLen = snprintf(_line, sizeof(_line), "sample %08lx %08lx %u %u\n",
+                            static_cast<unsigned long>(slot.pc),
+                            static_cast<unsigned long>(slot.caller),
+                            static_cast<unsigned>(slot.task),
+                            static_cast<unsigned>(slot.count));
+        return true;
+      }
+      _stage = Stage::Done;
+      return false;
+
+    case Stage::Done:
+      return false;
+  }
+  return false;
+}
+
+size_t TextExporter::fill(uint8_t* buf, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (_lineOffset >= _lineLen && !nextLine()) break;
+    const size_t chunk = min(_lineLen - _lineOffset, maxLen - written);
+    memcpy(buf + written, _line + _lineOffset, chunk);
+    _lineOffset += chunk;
+    written += chunk;
+  }
+  return written;
+}
+
+}  // namespace Profiler
+
+#else
+
+namespace Profiler {
+
+void begin() {}
+void reset() {}
+uint32_t totalSamples() { return 0; }
+
+TextExporter::TextExporter() : _stage(Stage::Done) {}
+bool TextExporter::nextLine() { return false; }
+size_t TextExporter::fill(uint8_t*, size_t) { return 0; }
+
+}  // namespace Profiler
+
+#endif
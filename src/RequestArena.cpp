@@ -0,0 +1,116 @@
+#include "RequestArena.h"
+
+#include <freertos/FreeRTOS.h>
+
+namespace {
+alignas(8) uint8_t s_storage[REQUEST_ARENA_COUNT][REQUEST_ARENA_SIZE];
+RequestArena s_arenas[REQUEST_ARENA_COUNT];
+RequestArena s_heapArena;
+RequestArenaStats s_stats;
+portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+}  // namespace
+
+RequestArena* RequestArena::acquire() {
+  portENTER_CRITICAL(&s_lock);
+  ++s_stats.acquired;
+  for (size_t i = 0; i < REQUEST_ARENA_COUNT; ++i) {
+    RequestArena& arena = s_arenas[i];
+    if (arena._inUse) continue;
+    arena._buf = s_storage[i];
+    arena._capacity = REQUEST_ARENA_SIZE;
+    arena.reset();
+    arena._inUse = true;
+    ++s_stats.inUse;
+    portEXIT_CRITICAL(&s_lock);
+    return &arena;
+  }
+  ++s_stats.exhausted;
+  portEXIT_CRITICAL(&s_lock);
+  return &s_heapArena;
+}
+
+void RequestArena::release(RequestArena* arena) {
+  if (arena == nullptr || !arena->pooled()) return;
+  portENTER_CRITICAL(&s_lock);
+  if (arena->_inUse) {
+    arena->_inUse = false;
+    --s_stats.inUse;
+  }
+  arena->reset();
+  portEXIT_CRITICAL(&s_lock);
+}
+
+RequestArenaStats RequestArena::stats() {
+  portENTER_CRITICAL(&s_lock);
+  const RequestArenaStats copy = s_stats;
+  portEXIT_CRITICAL(&s_lock);
+  return copy;
+}
+
+void RequestArena::reset() {
+  _used = 0;
+  _lastOffset = SIZE_MAX;
+}
+
+bool RequestArena::owns(const void* ptr) const {
+  const auto* p = static_cast<const uint8_t*>(ptr);
+  return pooled() && p >= _buf && p < _buf + _capacity;
+}
+
+void* RequestArena::allocate(size_t size) {
+  if (pooled()) {
+    const size_t need = sizeof(Header) + align(size);
+    if (_used + need <= _capacity) {
+      auto* header = reinterpret_cast<Header*>(_buf + _used);
+      header->size = static_cast<uint32_t>(size);
+      _lastOffset = _used;
+      _used += need;
+      if (_used > s_stats.highWaterBytes) s_stats.highWaterBytes = _used;
+      return header + 1;
+    }
+    ++s_stats.heapSpills;
+  }
+  return malloc(size);
+}
+
+void RequestArena::deallocate(void* ptr) {
+  if (ptr == nullptr) return;
+  if (!owns(ptr)) {
+    free(ptr);
+    return;
+  }
+  const auto* header = static_cast<const Header*>(ptr) - 1;
+  const size_t offset = reinterpret_cast<const uint8_t*>(header) - _buf;
+  if (offset == _lastOffset) {
+    _used = offset;
+    _lastOffset = SIZE_MAX;
+  }
+}
+
+void* RequestArena::reallocate(void* ptr, size_t newSize) {
+  if (ptr == nullptr) return allocate(newSize);
+  if (!owns(ptr)) return realloc(ptr, newSize);
+
+  auto* header = static_cast<Header*>(ptr) - 1;
+  const size_t offset = reinterpret_cast<uint8_t*>(header) - _buf;
+  const size_t need = sizeof(Header) + align(newSize);
+  if (offset == _lastOffset && offset + need <= _capacity) {
+    header->size = static_cast<uint32_t>(newSize);
+    _used = offset + need;
+    if (_used > s_stats.highWaterBytes) s_stats.highWaterBytes = _used;
+    return ptr;
+  }
+
+  const size_t oldSize = header->size;
+  void* moved = allocate(newSize);
+  if (moved == nullptr) return nullptr;
+  memcpy(moved, ptr, min(oldSize, newSize));
+  return moved;
+}
+
+char* RequestArena::allocText(size_t size) {
+  if (!pooled()) return nullptr;
+  const size_t need = sizeof(Header) + align(size);
+  if (_used + need > _capacity) return nullptr;
+  return static_cast<char*>(allocate(size));
+}
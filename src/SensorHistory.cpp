@@ -0,0 +1,79 @@
+#include "SensorHistory.h"
+
+#include <algorithm>
+
+bool SensorHistory::begin() {
+  if (!_ring.begin(
+          [this](uint32_t segment) { resetSegment(segment); },
+          [this](uint32_t seq, const SensorRecord& record) {
+            noteRecord(seq, record);
+          })) {
+    Serial.println(F("Sensor history: cannot create /history"));
+    return false;
+  }
+  Serial.printf("Sensor history: %lu samples\n",
+                static_cast<unsigned long>(nextSeq() - firstSeq()));
+  return true;
+}
+
+void SensorHistory::append(const SensorRecord& record) {
+  _ring.append([&record]() { return record; },
+               [this](uint32_t segment) { resetSegment(segment); },
+               [this](uint32_t seq, const SensorRecord& written) {
+                 noteRecord(seq, written);
+               });
+}
+
+SensorQuery SensorHistory::makeQuery(uint32_t from, uint32_t to) {
+  return _ring.locked([&]() {
+    SensorQuery query;
+    query.from = from;
+    query.to = to;
+    query.cursor = _ring.firstSeq();
+    query.endSeq = _ring.nextSeq();
+    while (query.cursor < query.endSeq) {
+      const uint32_t segment = query.cursor / SEGMENT_RECORDS;
+      if (_segments[segment % MAX_SEGMENTS].maxEpoch >= from) break;
+      query.cursor = (segment + 1) * SEGMENT_RECORDS;
+    }
+    query.cursor = std::min(query.cursor, query.endSeq);
+    return query;
+  });
+}
+
+size_t SensorHistory::read(SensorQuery& query, SensorRecord* out,
+                           size_t max) {
+  size_t count = 0;
+  return _ring.read(
+      query.cursor, query.endSeq, max,
+      [&](uint32_t cursor) {
+        while (cursor < query.endSeq &&
+               !segmentMatches(cursor / SEGMENT_RECORDS, query.from,
+                               query.to)) {
+          cursor = std::min<uint32_t>(
+              (cursor / SEGMENT_RECORDS + 1) * SEGMENT_RECORDS, query.endSeq);
+        }
+        return cursor;
+      },
+      [&](uint32_t, const SensorRecord& record) {
+        if (record.epoch < query.from || record.epoch > query.to) return false;
+        out[count++] = record;
+        return true;
+      });
+}
+
+void SensorHistory::resetSegment(uint32_t segment) {
+  _segments[segment % MAX_SEGMENTS] = {};
+}
+
+void SensorHistory::noteRecord(uint32_t seq, const SensorRecord& record) {
+  SegmentIndex& index = _segments[(seq / SEGMENT_RECORDS) % MAX_SEGMENTS];
+  index.minEpoch = std::min(index.minEpoch, record.epoch);
+  index.maxEpoch = std::max(index.maxEpoch, record.epoch);
+}
+
+bool SensorHistory::segmentMatches(uint32_t segment, uint32_t from,
+                                   uint32_t to) const {
+  const SegmentIndex& index = _segments[segment % MAX_SEGMENTS];
+  return index.minEpoch <= to && index.maxEpoch >= from;
+}
@@ -1,6 +1,11 @@
 #include "Sensors.h"
+
+#include "Trace.h"
+
 #include <Wire.h>
 
+#include <algorithm>
+
 SHT21Sensor::SHT21Sensor() : _sht(SHT2x_SENSOR, HUMD_12BIT_TEMP_14BIT) {}
 
 bool SHT21Sensor::begin() {
@@ -30,12 +35,16 @@ SensorData SHT21Sensor::read() {
 
   if (temperature == HTU2XD_SHT2X_SI70XX_ERROR || humidity == HTU2XD_SHT2X_SI70XX_ERROR) {
     data.valid = false;
+    ++_errorCount;
     Serial.println(F("SHT21 read failed (CRC error)"));
     return data;
   }
 
-  data.temperature = temperature;
-  data.humidity = _sht.getCompensatedHumidity(temperature);
+  const float humidityPct = _sht.getCompensatedHumidity(temperature);
+  data.temperatureCenti =
+      static_cast<int16_t>(std::clamp(toCenti(temperature), -32768, 32767));
+  data.humidityCenti =
+      static_cast<uint16_t>(std::clamp(toCenti(humidityPct), 0, 10000));
   data.valid = true;
 
   return data;
@@ -53,7 +62,9 @@ void SensorManager::update() {
   if (millis() - _lastRead < _readIntervalMs) return;
   _lastRead = millis();
 
+  TRACE_SCOPE("SensorManager::update");
   _data = _sht21.read();
+  _data.sampledAtMs = _lastRead;
 }
 
 SensorData SensorManager::getData() const { return _data; }
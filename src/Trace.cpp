@@ -0,0 +1,130 @@
+#include "Trace.h"
+
+#include <atomic>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace {
+static_assert((TRACE_CAPACITY & (TRACE_CAPACITY - 1)) == 0,
+              "TRACE_CAPACITY must be a power of two");
+constexpr uint32_t MASK = TRACE_CAPACITY - 1;
+
+struct Event {
+  std::atomic<uint32_t> seq{0};
+  const char* name = nullptr;
+  uint32_t tsUs = 0;
+  uint32_t durUs = 0;
+  uint32_t tid = 0;
+  char phase = 0;
+};
+
+Event s_ring[TRACE_CAPACITY];
+std::atomic<uint32_t> s_head{0};
+std::atomic<uint8_t> s_exporters{0};
+
+void record(const char* name, char phase, uint32_t tsUs, uint32_t durUs) {
+  if (s_exporters.load(std::memory_order_relaxed) != 0) return;
+  const uint32_t idx = s_head.fetch_add(1, std::memory_order_relaxed);
+  Event& e = s_ring[idx & MASK];
+  e.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.name = name;
+  e.tsUs = tsUs;
+  e.durUs = durUs;
+  e.tid = reinterpret_cast<uintptr_t>(xTaskGetCurrentTaskHandle());
+  e.phase = phase;
+  e.seq.store(idx + 1, std::memory_order_release);
+}
+
+uint32_t nowUs() { return static_cast<uint32_t>(esp_timer_get_time()); }
+}  // namespace
+
+namespace Trace {
+
+void begin(const char* name) { record(name, 'B', nowUs(), 0); }
+
+void end(const char* name) { record(name, 'E', nowUs(), 0); }
+
+void slow(const char* name, uint32_t startUs, uint32_t minUs) {
+  const uint32_t durUs = nowUs() - startUs;
+  if (durUs >= minUs) record(name, 'X', startUs, durUs);
+}
+
+ChromeExporter::ChromeExporter() {
+  s_exporters.fetch_add(1, std::memory_order_relaxed);
+  _end = s_head.load(std::memory_order_acquire);
+  _cursor = _end > TRACE_CAPACITY ? _end - TRACE_CAPACITY : 0;
+}
+
+ChromeExporter::~ChromeExporter() {
+  s_exporters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool ChromeExporter::nextLine() {
+  _lineOffset = 0;
+  _lineLen = 0;
+
+  switch (_stage) {
+    case Stage::Header:
+      _lineLen = snprintf(_line, sizeof(_line),
+                          "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+      _stage = Stage::Events;
+      return true;
+
+    case Stage::Events:
+      while (_cursor < _end) {
+        const uint32_t idx = _cursor++;
+        const Event& e = s_ring[idx & MASK];
+        if (e.seq.load(std::memory_order_acquire) != idx + 1) continue;
+        const char* name = e.name;
+        const uint32_t tsUs = e.tsUs;
+        const uint32_t durUs = e.durUs;
+        const uint32_t tid = e.tid;
+        const char phase = e.phase;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (e.seq.load(std::memory_order_relaxed) != idx + 1) continue;
+
+        char dur[24] = "";
+        if (phase == 'X') {
+          snprintf(dur, sizeof(dur), ",\"dur\":%lu",
+                   static_cast<unsigned long>(durUs));
+        }
+        const int written = snprintf(
+            _line, sizeof(_line),
+            "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu%s,\"pid\":1,"
+            "\"tid\":%lu}",
+            _first ? "" : ",", name, phase, static_cast<unsigned long>(tsUs),
+            dur, static_cast<unsigned long>(tid));
+        if (written <= 0) continue;
+        _lineLen = min(static_cast<size_t>(written), sizeof(_line) - 1);
+        _first = false;
+        return true;
+      }
+      _stage = Stage::Footer;
+      [[fallthrough]];
+
+    case Stage::Footer:
+      _lineLen = snprintf(_line, sizeof(_line), "]}");
+      _stage = Stage::Done;
+      return true;
+
+    case Stage::Done:
+      return false;
+  }
+  return false;
+}
+
+size_t ChromeExporter::fill(uint8_t* buf, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (_lineOffset >= _lineLen && !nextLine()) break;
+    const size_t chunk = min(_lineLen - _lineOffset, maxLen - written);
+    memcpy(buf + written, _line + _lineOffset, chunk);
+    _lineOffset += chunk;
+    written += chunk;
+  }
+  return written;
+}
+
+}  // namespace Trace
@@ -0,0 +1,178 @@
+#include "UploadScheduler.h"
+
+#include <algorithm>
+
+namespace {
+void mergeTelemetry(TelemetryLogPayload& into,
+                    const TelemetryLogPayload& next) {
+  into.temperatureCentiSum += next.temperatureCentiSum;
+  into.humidityCentiSum += next.humidityCentiSum;
+  into.temperatureMinCenti =
+      min(into.temperatureMinCenti, next.temperatureMinCenti);
+  into.temperatureMaxCenti =
+      max(into.temperatureMaxCenti, next.temperatureMaxCenti);
+  into.humidityMinCenti = min(into.humidityMinCenti, next.humidityMinCenti);
+  into.humidityMaxCenti = max(into.humidityMaxCenti, next.humidityMaxCenti);
+  into.fan1OnCount += next.fan1OnCount;
+  into.fan2OnCount += next.fan2OnCount;
+  into.alarmState = into.alarmState || next.alarmState;
+  into.sampleCount += next.sampleCount;
+  into.periodEndEpoch =
+      next.periodEndEpoch != 0 ? next.periodEndEpoch : next.epoch;
+}
+}  // namespace
+
+void UploadScheduler::configure(UploadClass cls, const ClassPolicy& policy) {
+  lane(cls).policy = policy;
+}
+
+bool UploadScheduler::enqueue(UploadClass cls, UploadItem item) {
+  Lane& l = lane(cls);
+  if (l.items.size() >= l.policy.capacity) {
+    switch (l.policy.overflow) {
+      case OverflowPolicy::KeepNewest:
+        l.items.pop_front();
+        ++l.dropped;
+        break;
+      case OverflowPolicy::KeepOldest:
+        ++l.dropped;
+        return false;
+      case OverflowPolicy::Downsample:
+        downsample(l);
+        break;
+      case OverflowPolicy::Coalesce:
+        if (coalesce(l)) {
+          ++l.coalesced;
+        } else {
+          l.items.pop_front();
+          ++l.dropped;
+        }
+        break;
+    }
+  }
+  l.items.push_back(std::move(item));
+  HeapTracker::noteQueueDepth(
+      static_cast<HeapQueue>(static_cast<size_t>(HeapQueue::UploadUrgent) +
+                             static_cast<size_t>(cls)),
+      l.items.size());
+  return true;
+}
+
+void UploadScheduler::downsample(Lane& l) {
+  const size_t half = l.items.size() / 2;
+  size_t kept = 0;
+  for (size_t i = 0; i < half; ++i) {
+    if (i % 2 == 0) l.items[kept++] = std::move(l.items[i]);
+  }
+  const size_t removed = half - kept;
+  l.items.erase(l.items.begin() + kept, l.items.begin() + half);
+  l.dropped += removed;
+}
+
+bool UploadScheduler::coalesce(Lane& l) {
+  size_t bestIndex = l.items.size();
+  uint32_t bestCount = UINT32_MAX;
+  for (size_t i = 0; i + 1 < l.items.size(); ++i) {
+    const auto* a = std::get_if<TelemetryLogPayload>(&l.items[i].payload);
+    const auto* b = std::get_if<TelemetryLogPayload>(&l.items[i + 1].payload);
+    if (a == nullptr || b == nullptr) continue;
+    if (a->sampleCount + b->sampleCount > UINT16_MAX) continue;
+    const uint32_t count = a->sampleCount + b->sampleCount;
+    if (count < bestCount) {
+      bestCount = count;
+      bestIndex = i;
+    }
+  }
+  if (bestIndex >= l.items.size()) return false;
+
+  auto& into = std::get<TelemetryLogPayload>(l.items[bestIndex].payload);
+  mergeTelemetry(into,
+                 std::get<TelemetryLogPayload>(l.items[bestIndex + 1].payload));
+  l.items.erase(l.items.begin() + bestIndex + 1);
+  return true;
+}
+
+UploadClass UploadScheduler::next(unsigned long nowMs) const {
+  UploadClass best = UploadClass::Count;
+  uint64_t bestScore = 0;
+
+  for (size_t i = 0; i < CLASS_COUNT; ++i) {
+    const Lane& l = _lanes[i];
+    if (l.items.empty()) continue;
+    if (l.policy.preempt) return static_cast<UploadClass>(i);
+
+    const unsigned long age = nowMs - l.items.front().enqueuedMs;
+    const unsigned long agingMs = max(l.policy.agingMs, 1UL);
+    const uint64_t score = static_cast<uint64_t>(l.policy.weight) *
+                           (1000ULL + (1000ULL * age) / agingMs);
+    if (best == UploadClass::Count || score > bestScore) {
+      best = static_cast<UploadClass>(i);
+      bestScore = score;
+    }
+  }
+  return best;
+}
+
+const UploadItem& UploadScheduler::front(UploadClass cls) const {
+  return lane(cls).items.front();
+}
+
+void UploadScheduler::complete(UploadClass cls, unsigned long nowMs) {
+  Lane& l = lane(cls);
+  if (l.items.empty()) return;
+
+  l.latencies[l.latencyHead] = nowMs - l.items.front().enqueuedMs;
+  l.latencyHead = (l.latencyHead + 1) % LATENCY_WINDOW;
+  if (l.latencyCount < LATENCY_WINDOW) ++l.latencyCount;
+  l.items.pop_front();
+}
+
+bool UploadScheduler::empty() const {
+  for (const auto& l : _lanes) {
+    if (!l.items.empty()) return false;
+  }
+  return true;
+}
+
+size_t UploadScheduler::size(UploadClass cls) const {
+  return lane(cls).items.size();
+}
+
+uint32_t UploadScheduler::dropped(UploadClass cls) const {
+  return lane(cls).dropped;
+}
+
+uint32_t UploadScheduler::coalesced(UploadClass cls) const {
+  return lane(cls).coalesced;
+}
+
+LatencyPercentiles UploadScheduler::percentiles(UploadClass cls) const {
+  const Lane& l = lane(cls);
+  LatencyPercentiles out;
+  out.samples = l.latencyCount;
+  if (l.latencyCount == 0) return out;
+
+  std::array<uint32_t, LATENCY_WINDOW> sorted = l.latencies;
+  std::sort(sorted.begin(), sorted.begin() + l.latencyCount);
+  const auto at = [&](uint8_t pct) {
+    return sorted[(static_cast<size_t>(l.latencyCount) - 1) * pct / 100];
+  };
+  out.p50 = at(50);
+  out.p90 = at(90);
+  out.p99 = at(99);
+  out.max = sorted[l.latencyCount - 1];
+  return out;
+}
+
+const char* UploadScheduler::className(UploadClass cls) {
+  switch (cls) {
+    case UploadClass::Urgent:
+      return "urgent";
+    case UploadClass::Access:
+      return "access";
+    case UploadClass::Telemetry:
+      return "telemetry";
+    default:
+      return "unknown";
+  }
+}
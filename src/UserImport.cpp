@@ -0,0 +1,171 @@
+#include "UserImport.h"
+
+namespace {
+// Splits one field off `cursor` in place, undoing CSV double-quote escaping.
+// Leaves `cursor` null after the last field.
+const char* nextCsvField(char*& cursor) {
+  if (cursor == nullptr) return "";
+  char* field = cursor;
+  char* in = cursor;
+  if (*in == '"') {
+    char* out = field;
+    ++in;
+    while (*in != '\0') {
+      if (*in == '"') {
+        if (in[1] != '"') {
+          ++in;
+          break;
+        }
+        ++in;
+      }
+      *out++ = *in++;
+    }
+    *out = '\0';
+  }
+  char* comma = strchr(in, ',');
+  if (comma != nullptr) *comma = '\0';
+  cursor = comma != nullptr ? comma + 1 : nullptr;
+  return field;
+}
+
+bool parseEnabled(const char* value, bool& out) {
+  if (*value == '\0' || strcmp(value, "1") == 0 ||
+      strcasecmp(value, "true") == 0 || strcasecmp(value, "yes") == 0) {
+    out = true;
+    return true;
+  }
+  if (strcmp(value, "0") == 0 || strcasecmp(value, "false") == 0 ||
+      strcasecmp(value, "no") == 0) {
+    out = false;
+    return true;
+  }
+  return false;
+}
+
+bool validUserId(const char* userId) {
+  const size_t len = strlen(userId);
+  if (len == 0 || len > UserImport::USER_ID_MAX) return false;
+  for (const char* c = userId; *c != '\0'; ++c) {
+    if (!isgraph(static_cast<unsigned char>(*c)) || *c == '/') return false;
+  }
+  return true;
+}
+}  // namespace
+
+void UserImport::feed(const uint8_t* data, size_t len) {
+  _bytes += len;
+  for (size_t i = 0; i < len; ++i) {
+    const char c = static_cast<char>(data[i]);
+    if (c == '\n') {
+      endLine();
+    } else if (_lineLen + 1 < LINE_CAPACITY) {
+      _line[_lineLen++] = c;
+    } else {
+      _lineTooLong = true;
+    }
+  }
+}
+
+void UserImport::finish() {
+  if (_lineLen > 0 || _lineTooLong) endLine();
+}
+
+void UserImport::endLine() {
+  ++_lineNo;
+  if (_lineLen > 0 && _line[_lineLen - 1] == '\r') --_lineLen;
+  _line[_lineLen] = '\0';
+  if (_lineTooLong) {
+    reject("line too long");
+  } else {
+    parseLine(_line);
+  }
+  _lineLen = 0;
+  _lineTooLong = false;
+}
+
+void UserImport::parseLine(char* line) {
+  while (*line == ' ' || *line == '\t') ++line;
+  if (*line == '\0' || *line == '#') return;
+
+  Row row;
+  const char* reason = nullptr;
+  JsonDocument doc;
+  const bool parsed = *line == '{' ? parseJson(line, row, doc, reason)
+                                   : parseCsv(line, row, reason);
+  if (!parsed) {
+    if (reason != nullptr) reject(reason);
+    return;
+  }
+  if (!validUserId(row.userId)) {
+    reject("userId must be 1-23 visible characters without /");
+    return;
+  }
+  if (strlen(row.displayName) > DISPLAY_NAME_MAX) {
+    reject("displayName longer than 31");
+    return;
+  }
+  if (*row.pin != '\0' && !isValidPinFormat(row.pin)) {
+    reject("pin must be 4-8 numeric digits");
+    return;
+  }
+  stage(row);
+}
+
+bool UserImport::parseCsv(char* line, Row& row, const char*& reason) {
+  char* cursor = line;
+  row.userId = nextCsvField(cursor);
+  row.displayName = nextCsvField(cursor);
+  row.pin = nextCsvField(cursor);
+  const char* enabled = nextCsvField(cursor);
+
+  const bool header = !_sawRow && strcasecmp(row.userId, "userId") == 0;
+  _sawRow = true;
+  if (header) return false;
+  if (!parseEnabled(enabled, row.enabled)) {
+    reason = "enabled must be true or false";
+    return false;
+  }
+  return true;
+}
+
+bool UserImport::parseJson(const char* line, Row& row, JsonDocument& doc,
+                           const char*& reason) {
+  _sawRow = true;
+  const DeserializationError err = deserializeJson(doc, line);
+  if (err || !doc.is<JsonObject>()) {
+    reason = "invalid JSON";
+    return false;
+  }
+  JsonVariantConst pin = doc["pin"];
+  if (!pin.isNull() && !pin.is<const char*>()) {
+    reason = "pin must be a string";
+    return false;
+  }
+  row.userId = doc["userId"] | "";
+  row.displayName = doc["displayName"] | "";
+  row.pin = pin | "";
+  row.enabled = doc["enabled"] | true;
+  return true;
+}
+
+void UserImport::stage(const Row& row) {
+  size_t index = 0;
+  while (index < _userCount && _users[index].userId != row.userId) ++index;
+  if (index == _users.size()) {
+    reject("more users than the device holds");
+    return;
+  }
+  if (index == _userCount) ++_userCount;
+
+  UserCredential& user = _users[index];
+  user.userId = row.userId;
+  user.displayName = *row.displayName != '\0' ? row.displayName : row.userId;
+  user.pinHash = *row.pin != '\0' ? hashPinSha256(row.pin) : String();
+  user.enabled = row.enabled;
+  _userLines[index] = _lineNo;
+}
+
+void UserImport::reject(const char* reason) {
+  ++_rejected;
+  if (_errorCount < _errors.size()) _errors[_errorCount++] = {_lineNo, reason};
+}
@@ -1,29 +1,52 @@
 #include "WiFiHandler.h"
 
-#include <HTTPClient.h>
+#include "Metrics.h"
+
+#include <LittleFS.h>
 #include <algorithm>
 
+namespace {
+constexpr uint32_t FAST_CACHE_MAGIC = 0x57464332;  // "WFC2"
+}  // namespace
+
 void WiFiManager::begin(ConfigManager* config) {
   _config = config;
   WiFi.mode(WIFI_STA);
   WiFi.setAutoReconnect(true);
+  _probe.begin([this](const ProbeOutcome& outcome) { onProbeResult(outcome); });
+
+  loadFastCache();
+  _connectStartMs = millis();
 
   if (_config->getWiFiCount() == 0) {
     Serial.println(F("No saved WiFi networks, starting AP mode"));
     startApMode();
-  } else {
+  } else if (!tryFastConnect()) {
     startScan();
   }
 }
 
 void WiFiManager::update() {
   unsigned long now = millis();
+  _probe.poll();
+  startPendingJob();
+  if (_jobFromAp) _dnsServer.processNextRequest();
 
   switch (_state) {
     case State::ApMode:
       _dnsServer.processNextRequest();
       break;
 
+    case State::FastConnecting:
+      if (WiFi.status() == WL_CONNECTED) {
+        beginVerifying(now);
+      } else if (now - _lastAction > FAST_CONNECT_TIMEOUT) {
+        Serial.println(F("WiFi: Fast connect timeout, rescanning"));
+        abandonFastPath();
+        startScan();
+      }
+      break;
+
     case State::Scanning:
       if (WiFi.scanComplete() >= 0) {
         processScanResults();
@@ -34,36 +57,58 @@ void WiFiManager::update() {
 
     case State::Connecting:
       if (WiFi.status() == WL_CONNECTED) {
-        _state = State::Verifying;
-        _lastAction = now;
+        beginVerifying(now);
+        if (_jobActive) setJobState(ConnectJobState::Verifying);
       } else if (now - _lastAction > CONNECT_TIMEOUT) {
         Serial.println(F("WiFi: Connection timeout"));
-        tryNextNetwork();
+        if (_jobActive) {
+          failJob("Connection timeout");
+        } else {
+          tryNextNetwork();
+        }
       }
       break;
 
-    case State::Verifying: {
-      static unsigned long lastVerifyAttempt = 0;
-      if (now - lastVerifyAttempt > 2000) {
-        lastVerifyAttempt = now;
-        if (verifyInternet()) {
-          onConnected();
-          break;
-        }
+    case State::Verifying:
+      if (!_probe.busy() && now - _lastProbeMs > PROBE_INTERVAL) {
+        _lastProbeMs = now;
+        _probe.start(_config->read()->connectivityProbeUrl, PROBE_TIMEOUT_MS,
+                     _verifyAttempt);
       }
-      
+
       if (now - _lastAction > VERIFY_TIMEOUT) {
         Serial.println(F("WiFi: Internet verification failed"));
-        tryNextNetwork();
+        if (_jobActive) {
+          failJob("No internet access");
+        } else if (_fastPath) {
+          abandonFastPath();
+          startScan();
+        } else {
+          tryNextNetwork();
+        }
       }
       break;
-    }
 
     case State::Connected:
+      if (_apShutdownAtMs != 0 && now >= _apShutdownAtMs) {
+        _apShutdownAtMs = 0;
+        _jobFromAp = false;
+        _dnsServer.stop();
+        WiFi.softAPdisconnect(true);
+        WiFi.mode(WIFI_STA);
+      }
       if (WiFi.status() != WL_CONNECTED) {
-        Serial.println(F("WiFi: Connection lost, rescanning"));
+        Serial.println(F("WiFi: Connection lost, reconnecting"));
+        if (_roamScanActive) {
+          WiFi.scanDelete();
+          _roamScanActive = false;
+        }
+        ++_reconnectCount;
         _state = State::Idle;
-        startScan();
+        _connectStartMs = now;
+        if (!tryFastConnect()) startScan();
+      } else {
+        updateRoaming(now);
       }
       break;
 
@@ -75,6 +120,143 @@ void WiFiManager::update() {
   }
 }
 
+void WiFiManager::updateRoaming(unsigned long now) {
+  if (_roamScanActive) {
+    const int16_t status = WiFi.scanComplete();
+    if (status >= 0) {
+      processRoamScan();
+    } else if (status == WIFI_SCAN_FAILED) {
+      _roamScanActive = false;
+    }
+    return;
+  }
+  if (_jobFromAp) return;
+  const unsigned long interval = WiFi.RSSI() < ROAM_TRIGGER_RSSI
+                                     ? ROAM_SCAN_INTERVAL
+                                     : ROAM_SCAN_HEALTHY_INTERVAL;
+  if (now - _lastRoamScanMs < interval) return;
+
+  _lastRoamScanMs = now;
+  _roamScanActive = true;
+  WiFi.scanNetworks(true, false, true, ROAM_SCAN_MS_PER_CHAN);
+}
+
+void WiFiManager::processRoamScan() {
+  _roamScanActive = false;
+  const int n = WiFi.scanComplete();
+  const int32_t currentRssi = WiFi.RSSI();
+  const uint8_t* currentBssid = WiFi.BSSID();
+  const ConfigSnapshot config = _config->read();
+
+  int best = -1;
+  int32_t bestRssi = currentRssi + ROAM_HYSTERESIS_DB;
+  const WiFiCredential* bestCred = nullptr;
+  for (int i = 0; i < n; ++i) {
+    const int32_t rssi = WiFi.RSSI(i);
+    if (rssi < bestRssi) continue;
+    const uint8_t* bssid = WiFi.BSSID(i);
+    if (bssid == nullptr ||
+        (currentBssid != nullptr && memcmp(bssid, currentBssid, 6) == 0)) {
+      continue;
+    }
+    const String ssid = WiFi.SSID(i);
+    for (const auto& saved : config->wifiNetworks) {
+      if (saved.enabled && saved.ssid == ssid) {
+        best = i;
+        bestRssi = rssi;
+        bestCred = &saved;
+        break;
+      }
+    }
+  }
+
+  if (best < 0) {
+    WiFi.scanDelete();
+    return;
+  }
+
+  uint8_t bssid[6];
+  memcpy(bssid, WiFi.BSSID(best), sizeof(bssid));
+  const int32_t channel = WiFi.channel(best);
+  WiFi.scanDelete();
+
+  Serial.printf("WiFi: Roaming to %s (%ld dBm, was %ld dBm)\n",
+                bestCred->ssid.c_str(), static_cast<long>(bestRssi),
+                static_cast<long>(currentRssi));
+  Metrics::observeRoam();
+  abandonFastPath();
+  WiFi.begin(bestCred->ssid.c_str(), bestCred->password.c_str(), channel,
+             bssid);
+  _state = State::FastConnecting;
+  _lastAction = millis();
+  _connectStartMs = _lastAction;
+  _fastPath = true;
+}
+
+bool WiFiManager::tryFastConnect() {
+  if (!_fastCacheValid) return false;
+
+  const ConfigSnapshot config = _config->read();
+  const WiFiCredential* saved = nullptr;
+  for (const auto& net : config->wifiNetworks) {
+    if (net.enabled && net.ssid == _fastCache.ssid) {
+      saved = &net;
+      break;
+    }
+  }
+  if (saved == nullptr) return false;
+
+  Serial.printf("WiFi: Fast connect to %s (ch %u)\n", _fastCache.ssid,
+                static_cast<unsigned>(_fastCache.channel));
+
+  WiFi.begin(saved->ssid.c_str(), saved->password.c_str(), _fastCache.channel,
+             _fastCache.bssid);
+
+  _state = State::FastConnecting;
+  _lastAction = millis();
+  _fastPath = true;
+  return true;
+}
+
+void WiFiManager::abandonFastPath() { _fastPath = false; }
+
+void WiFiManager::loadFastCache() {
+  _fastCacheValid = false;
+  File file = LittleFS.open(FAST_CACHE_FILE, "r");
+  if (!file) return;
+  FastConnectCache cache{};
+  const size_t n =
+      file.read(reinterpret_cast<uint8_t*>(&cache), sizeof(cache));
+  file.close();
+  if (n != sizeof(cache) || cache.magic != FAST_CACHE_MAGIC) return;
+  cache.ssid[sizeof(cache.ssid) - 1] = '\0';
+  _fastCache = cache;
+  _fastCacheValid = true;
+}
+
+void WiFiManager::saveFastCache() {
+  FastConnectCache cache{};
+  cache.magic = FAST_CACHE_MAGIC;
+  strlcpy(cache.ssid, WiFi.SSID().c_str(), sizeof(cache.ssid));
+  const uint8_t* bssid = WiFi.BSSID();
+  if (bssid == nullptr) return;
+  memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+  cache.channel = static_cast<uint8_t>(WiFi.channel());
+
+  const bool sameLink =
+      _fastCacheValid && strcmp(cache.ssid, _fastCache.ssid) == 0 &&
+      memcmp(cache.bssid, _fastCache.bssid, sizeof(cache.bssid)) == 0 &&
+      cache.channel == _fastCache.channel;
+  if (sameLink) return;
+
+  File file = LittleFS.open(FAST_CACHE_FILE, "w");
+  if (!file) return;
+  file.write(reinterpret_cast<const uint8_t*>(&cache), sizeof(cache));
+  file.close();
+  _fastCache = cache;
+  _fastCacheValid = true;
+}
+
 void WiFiManager::startScan() {
   Serial.println(F("WiFi: Starting scan..."));
   _state = State::Scanning;
@@ -89,6 +271,7 @@ void WiFiManager::processScanResults() {
   _allScannedNetworks.clear();
   _matchedNetworks.clear();
 
+  const ConfigSnapshot config = _config->read();
   for (int i = 0; i < n; ++i) {
     ScannedNetwork sn;
     sn.ssid = WiFi.SSID(i);
@@ -96,7 +279,7 @@ void WiFiManager::processScanResults() {
     sn.open = WiFi.encryptionType(i) == WIFI_AUTH_OPEN;
     sn.saved = false;
 
-    for (const auto& saved : _config->data.wifiNetworks) {
+    for (const auto& saved : config->wifiNetworks) {
       if (saved.enabled && saved.ssid == sn.ssid) {
         sn.saved = true;
         _matchedNetworks.push_back({saved.ssid, saved.password, sn.rssi});
@@ -105,6 +288,7 @@ void WiFiManager::processScanResults() {
     }
     _allScannedNetworks.push_back(sn);
   }
+  HeapTracker::noteQueueDepth(HeapQueue::WiFiScan, _allScannedNetworks.size());
 
   WiFi.scanDelete();
 
@@ -140,17 +324,123 @@ void WiFiManager::tryNextNetwork() {
   ++_currentNetIndex;
 }
 
-bool WiFiManager::verifyInternet() {
-  HTTPClient http;
-  http.setTimeout(5000);
-  http.begin(CONNECTIVITY_CHECK_URL);
-  int code = http.GET();
-  http.end();
-  return code == 204;
+void WiFiManager::beginVerifying(unsigned long now) {
+  _state = State::Verifying;
+  _lastAction = now;
+  ++_verifyAttempt;
+}
+
+void WiFiManager::onProbeResult(const ProbeOutcome& outcome) {
+  if (_state != State::Verifying || outcome.attempt != _verifyAttempt) return;
+  if (outcome.online) {
+    onConnected();
+  } else {
+    Serial.printf("WiFi: Probe returned %d after %lu ms\n", outcome.httpCode,
+                  static_cast<unsigned long>(outcome.durationMs));
+  }
+}
+
+uint32_t WiFiManager::requestConnect(const String& ssid,
+                                     const String& password) {
+  std::lock_guard<std::mutex> lock(_jobLock);
+  if (_jobPending || _jobActive) return 0;
+  _job.id = ++_nextJobId;
+  _job.state = ConnectJobState::Queued;
+  _job.ssid = ssid;
+  _job.error = "";
+  _job.ip = "";
+  _jobPassword = password;
+  _jobPending = true;
+  ++_jobRevision;
+  return _job.id;
+}
+
+ConnectJob WiFiManager::connectJob() const {
+  std::lock_guard<std::mutex> lock(_jobLock);
+  return _job;
+}
+
+const char* WiFiManager::jobStateName(ConnectJobState state) {
+  switch (state) {
+    case ConnectJobState::Queued:
+      return "queued";
+    case ConnectJobState::Connecting:
+      return "connecting";
+    case ConnectJobState::Verifying:
+      return "verifying";
+    case ConnectJobState::Connected:
+      return "connected";
+    case ConnectJobState::Failed:
+      return "failed";
+  }
+  return "unknown";
+}
+
+void WiFiManager::startPendingJob() {
+  String ssid;
+  String password;
+  {
+    std::lock_guard<std::mutex> lock(_jobLock);
+    if (!_jobPending) return;
+    _jobPending = false;
+    _jobActive = true;
+    ssid = _job.ssid;
+    password = _jobPassword;
+    _jobPassword = "";
+  }
+
+  Serial.printf("WiFi: Job connecting to %s...\n", ssid.c_str());
+  _jobFromAp = _state == State::ApMode;
+  _roamScanActive = false;
+  if (_fastPath) abandonFastPath();
+  WiFi.mode(_jobFromAp ? WIFI_AP_STA : WIFI_STA);
+  WiFi.disconnect();
+  WiFi.begin(ssid.c_str(), password.c_str());
+
+  _state = State::Connecting;
+  _lastAction = millis();
+  _connectStartMs = _lastAction;
+  setJobState(ConnectJobState::Connecting);
+}
+
+void WiFiManager::setJobState(ConnectJobState state) {
+  std::lock_guard<std::mutex> lock(_jobLock);
+  _job.state = state;
+  ++_jobRevision;
+}
+
+void WiFiManager::failJob(const char* error) {
+  Serial.printf("WiFi: Job failed: %s\n", error);
+  {
+    std::lock_guard<std::mutex> lock(_jobLock);
+    _job.state = ConnectJobState::Failed;
+    _job.error = error;
+    _jobActive = false;
+    ++_jobRevision;
+  }
+  if (_jobFromAp) {
+    _jobFromAp = false;
+    startApMode();
+  } else {
+    startScan();
+  }
 }
 
 void WiFiManager::onConnected() {
   _state = State::Connected;
+  if (_jobActive) {
+    const String ip = WiFi.localIP().toString();
+    {
+      std::lock_guard<std::mutex> lock(_jobLock);
+      _job.state = ConnectJobState::Connected;
+      _job.ip = ip;
+      _jobActive = false;
+      ++_jobRevision;
+    }
+    if (_jobFromAp) _apShutdownAtMs = millis() + AP_GRACE_MS;
+  }
+  Metrics::observeWiFiConnect(millis() - _connectStartMs, _fastPath);
+  saveFastCache();
   Serial.printf("WiFi: Connected to %s, IP: %s\n", WiFi.SSID().c_str(),
                 WiFi.localIP().toString().c_str());
 }
@@ -177,7 +467,6 @@ IPAddress WiFiManager::getIP() const {
   return (_state == State::ApMode) ? WiFi.softAPIP() : WiFi.localIP();
 }
 
-std::vector<WiFiManager::ScannedNetwork> WiFiManager::getScannedNetworks()
-    const {
+WiFiManager::ScanList WiFiManager::getScannedNetworks() const {
   return _allScannedNetworks;
 }
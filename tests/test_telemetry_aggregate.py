@@ -0,0 +1,25 @@
+"""Skenario: Agregat — antrean penuh saat WAN putus, 4 baris digabung jadi 1."""
+import requests
+
+URL = "https://script.google.com/macros/s/AKfycbxVuisohtU0X2y6SBJhpR7stwr54dERGWv8wgq9KsjWhxZb-eH541N9pq33luIBhrWH4g/exec"
+
+params = {
+    "sheet": "telemetry_aggregates",
+    "period_start": "2026-03-01T10:00:00",
+    "period_end": "2026-03-01T10:04:00",
+    "device_id": "esp32-smart-server-01",
+    "sample_count": 4,
+    "temperature_min_c": 27.6,
+    "temperature_max_c": 28.4,
+    "temperature_avg_c": 28.0,
+    "humidity_min_pct": 61.0,
+    "humidity_max_pct": 64.5,
+    "humidity_avg_pct": 62.8,
+    "fan1_on_fraction": 1.0,
+    "fan2_on_fraction": 0.5,
+    "any_alarm": "true",
+}
+
+resp = requests.get(URL, params=params)
+print(f"[AGGREGATE] Status: {resp.status_code}")
+print(resp.text)
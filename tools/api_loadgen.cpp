@@ -0,0 +1,399 @@
+// Host-side load generator for the device REST API.
+//
+// Build:
+//   g++ -std=c++17 -O2 -pthread tools/api_loadgen.cpp -o api_loadgen
+//
+// Usage:
+//   ./api_loadgen --host monitor-server.local --duration 30
+//   ./api_loadgen --host 192.168.1.50 --mix /api/state:8,/:1 --rate 2
+//   ./api_loadgen --host monitor-server.local --write-baseline base.txt
+//   ./api_loadgen --host monitor-server.local --baseline base.txt
+//
+// Every request opens its own connection, as the device closes it after each
+// response. 429 and 503 are counted as shed (admission control), not errors.
+// All clients share this host's IP and so one 4 req/s admission bucket; the
+// default of one client at 3 req/s stays under it. Above MAX_BASELINE_SHED_PCT
+// shed the run mostly measures the rate limiter: it warns, and refuses to
+// write a baseline.
+// With --baseline the run fails (exit 1) when a path's p99 grows past the
+// tolerance or its error rate rises by more than one percentage point.
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double MAX_BASELINE_SHED_PCT = 5.0;
+
+struct Options {
+  std::string host;
+  std::string port = "80";
+  int clients = 1;
+  double durationSec = 20.0;
+  double ratePerClient = 3.0;
+  int timeoutMs = 5000;
+  double tolerance = 0.25;
+  std::string mix =
+      "/api/state:6,/api/users:1,/api/config/thermal:1,"
+      "/api/config/security:1,/:1";
+  std::string baseline;
+  std::string writeBaseline;
+};
+
+struct MixEntry {
+  std::string path;
+  int weight = 1;
+};
+
+struct PathStats {
+  std::vector<double> latencyMs;
+  uint64_t ok = 0;
+  uint64_t shed = 0;
+  uint64_t errors = 0;
+  uint64_t bytes = 0;
+};
+
+struct Summary {
+  uint64_t requests = 0;
+  double p50 = 0;
+  double p90 = 0;
+  double p99 = 0;
+  double max = 0;
+  double errorPct = 0;
+  double shedPct = 0;
+  double rps = 0;
+};
+
+[[noreturn]] void usage(const char* argv0) {
+  std::fprintf(stderr,
+               "usage: %s --host HOST [--port 80] [--clients 1] "
+               "[--duration 20]\n"
+               "          [--rate REQ_PER_SEC_PER_CLIENT, 0 = closed loop; 3]\n"
+               "          [--timeout-ms 5000]\n"
+               "          [--mix /path:weight,...] [--baseline FILE] "
+               "[--write-baseline FILE]\n"
+               "          [--tolerance 0.25]\n",
+               argv0);
+  std::exit(2);
+}
+
+Options parseArgs(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) usage(argv[0]);
+      return argv[++i];
+    };
+    if (arg == "--host") {
+      opt.host = value();
+    } else if (arg == "--port") {
+      opt.port = value();
+    } else if (arg == "--clients") {
+      opt.clients = std::max(1, std::atoi(value().c_str()));
+    } else if (arg == "--duration") {
+      opt.durationSec = std::atof(value().c_str());
+    } else if (arg == "--rate") {
+      opt.ratePerClient = std::atof(value().c_str());
+    } else if (arg == "--timeout-ms") {
+      opt.timeoutMs = std::atoi(value().c_str());
+    } else if (arg == "--mix") {
+      opt.mix = value();
+    } else if (arg == "--baseline") {
+      opt.baseline = value();
+    } else if (arg == "--write-baseline") {
+      opt.writeBaseline = value();
+    } else if (arg == "--tolerance") {
+      opt.tolerance = std::atof(value().c_str());
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (opt.host.empty()) usage(argv[0]);
+  return opt;
+}
+
+std::vector<MixEntry> parseMix(const std::string& spec) {
+  std::vector<MixEntry> mix;
+  std::stringstream in(spec);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    if (item.empty()) continue;
+    MixEntry entry;
+    const size_t colon = item.rfind(':');
+    entry.path = colon == std::string::npos ? item : item.substr(0, colon);
+    if (colon != std::string::npos) {
+      entry.weight = std::max(0, std::atoi(item.c_str() + colon + 1));
+    }
+    if (entry.weight > 0) mix.push_back(entry);
+  }
+  return mix;
+}
+
+bool waitFor(int fd, short events, int timeoutMs) {
+  pollfd pfd{fd, events, 0};
+  return poll(&pfd, 1, timeoutMs) == 1 && (pfd.revents & events) != 0;
+}
+
+int connectTo(const addrinfo* addr, int timeoutMs) {
+  const int fd = socket(addr->ai_family, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  timeval tv{timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  if (connect(fd, addr->ai_addr, addr->ai_addrlen) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Returns the HTTP status, or -1 on a socket or protocol error.
+int fetch(const addrinfo* addr, const Options& opt, const std::string& path,
+          uint64_t& bytes) {
+  const int fd = connectTo(addr, opt.timeoutMs);
+  if (fd < 0) return -1;
+
+  const std::string request = "GET " + path + " HTTP/1.1\r\nHost: " +
+                              opt.host + "\r\nConnection: close\r\n\r\n";
+  if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) !=
+      static_cast<ssize_t>(request.size())) {
+    close(fd);
+    return -1;
+  }
+
+  char buf[2048];
+  std::string head;
+  int status = -1;
+  for (;;) {
+    if (!waitFor(fd, POLLIN, opt.timeoutMs)) {
+      status = -1;
+      break;
+    }
+    const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    bytes += static_cast<uint64_t>(n);
+    if (status < 0 && head.size() < 64) {
+      head.append(buf, static_cast<size_t>(n));
+      int code = 0;
+      if (std::sscanf(head.c_str(), "HTTP/1.%*d %d", &code) == 1) {
+        status = code;
+      }
+    }
+  }
+  close(fd);
+  return status;
+}
+
+double percentile(const std::vector<double>& sorted, double pct) {
+  if (sorted.empty()) return 0;
+  const size_t index = std::min(
+      sorted.size() - 1,
+      static_cast<size_t>(pct / 100.0 * (sorted.size() - 1) + 0.5));
+  return sorted[index];
+}
+
+Summary summarize(PathStats stats, double elapsedSec) {
+  Summary out;
+  out.requests = stats.ok + stats.shed + stats.errors;
+  std::sort(stats.latencyMs.begin(), stats.latencyMs.end());
+  out.p50 = percentile(stats.latencyMs, 50);
+  out.p90 = percentile(stats.latencyMs, 90);
+  out.p99 = percentile(stats.latencyMs, 99);
+  out.max = stats.latencyMs.empty() ? 0 : stats.latencyMs.back();
+  if (out.requests > 0) {
+    out.errorPct = 100.0 * stats.errors / out.requests;
+    out.shedPct = 100.0 * stats.shed / out.requests;
+  }
+  out.rps = elapsedSec > 0 ? stats.ok / elapsedSec : 0;
+  return out;
+}
+
+void merge(PathStats& into, const PathStats& from) {
+  into.latencyMs.insert(into.latencyMs.end(), from.latencyMs.begin(),
+                        from.latencyMs.end());
+  into.ok += from.ok;
+  into.shed += from.shed;
+  into.errors += from.errors;
+  into.bytes += from.bytes;
+}
+
+std::map<std::string, Summary> loadBaseline(const std::string& file) {
+  std::map<std::string, Summary> out;
+  std::ifstream in(file);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream fields(line);
+    std::string path;
+    Summary s;
+    if (fields >> path >> s.p50 >> s.p90 >> s.p99 >> s.max >> s.errorPct >>
+        s.rps) {
+      out[path] = s;
+    }
+  }
+  return out;
+}
+
+void writeBaseline(const std::string& file,
+                   const std::map<std::string, Summary>& rows) {
+  std::ofstream out(file);
+  out << "# path p50_ms p90_ms p99_ms max_ms error_pct ok_rps\n";
+  for (const auto& [path, s] : rows) {
+    out << path << ' ' << s.p50 << ' ' << s.p90 << ' ' << s.p99 << ' '
+        << s.max << ' ' << s.errorPct << ' ' << s.rps << '\n';
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const Options opt = parseArgs(argc, argv);
+  const std::vector<MixEntry> mix = parseMix(opt.mix);
+  if (mix.empty()) usage(argv[0]);
+
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addr = nullptr;
+  if (getaddrinfo(opt.host.c_str(), opt.port.c_str(), &hints, &addr) != 0 ||
+      addr == nullptr) {
+    std::fprintf(stderr, "cannot resolve %s\n", opt.host.c_str());
+    return 2;
+  }
+
+  std::vector<int> weights;
+  for (const MixEntry& entry : mix) weights.push_back(entry.weight);
+
+  const auto start = Clock::now();
+  const auto deadline =
+      start + std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double>(opt.durationSec));
+  std::vector<std::vector<PathStats>> perClient(
+      opt.clients, std::vector<PathStats>(mix.size()));
+  std::vector<std::thread> threads;
+  for (int c = 0; c < opt.clients; ++c) {
+    threads.emplace_back([&, c]() {
+      std::mt19937 rng(static_cast<uint32_t>(c) * 7919u + 1u);
+      std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+      const auto interval =
+          opt.ratePerClient > 0
+              ? std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(1.0 / opt.ratePerClient))
+              : Clock::duration::zero();
+      auto next = Clock::now();
+      while (Clock::now() < deadline) {
+        const size_t i = pick(rng);
+        PathStats& stats = perClient[c][i];
+        const auto sent = Clock::now();
+        const int status = fetch(addr, opt, mix[i].path, stats.bytes);
+        const double ms =
+            std::chrono::duration<double, std::milli>(Clock::now() - sent)
+                .count();
+        if (status >= 200 && status < 400) {
+          ++stats.ok;
+          stats.latencyMs.push_back(ms);
+        } else if (status == 429 || status == 503) {
+          ++stats.shed;
+        } else {
+          ++stats.errors;
+        }
+        if (interval != Clock::duration::zero()) {
+          next += interval;
+          std::this_thread::sleep_until(next);
+        }
+      }
+    });
+  }
+  for (std::thread& t : threads) t.join();
+  freeaddrinfo(addr);
+  const double elapsed =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::map<std::string, Summary> rows;
+  PathStats total;
+  for (size_t i = 0; i < mix.size(); ++i) {
+    PathStats path;
+    for (int c = 0; c < opt.clients; ++c) merge(path, perClient[c][i]);
+    merge(total, path);
+    rows[mix[i].path] = summarize(path, elapsed);
+  }
+  const Summary all = summarize(total, elapsed);
+
+  std::printf("%d clients, %.1fs, %llu requests, %.1f ok req/s, %.1f KiB\n",
+              opt.clients, elapsed,
+              static_cast<unsigned long long>(all.requests), all.rps,
+              total.bytes / 1024.0);
+  std::printf("%-24s %7s %8s %8s %8s %8s %7s %7s %7s\n", "path", "n", "p50ms",
+              "p90ms", "p99ms", "maxms", "err%", "shed%", "ok/s");
+  auto printRow = [](const std::string& name, const Summary& s) {
+    std::printf("%-24s %7llu %8.1f %8.1f %8.1f %8.1f %7.2f %7.2f %7.1f\n",
+                name.c_str(), static_cast<unsigned long long>(s.requests),
+                s.p50, s.p90, s.p99, s.max, s.errorPct, s.shedPct, s.rps);
+  };
+  for (const auto& [path, s] : rows) printRow(path, s);
+  printRow("(all)", all);
+
+  const bool mostlyShed = all.shedPct > MAX_BASELINE_SHED_PCT;
+  if (mostlyShed) {
+    std::printf(
+        "warning: %.1f%% shed by admission control; this run measures the "
+        "per-IP rate limit,\n         not the handlers. Keep clients x rate "
+        "under 4 req/s.\n",
+        all.shedPct);
+  }
+
+  if (!opt.writeBaseline.empty() && mostlyShed) {
+    std::printf("baseline not written\n");
+    return 1;
+  }
+  if (!opt.writeBaseline.empty()) {
+    rows["(all)"] = all;
+    writeBaseline(opt.writeBaseline, rows);
+    std::printf("baseline written to %s\n", opt.writeBaseline.c_str());
+  }
+
+  if (opt.baseline.empty()) return 0;
+  const auto baseline = loadBaseline(opt.baseline);
+  rows["(all)"] = all;
+  int regressions = 0;
+  for (const auto& [path, base] : baseline) {
+    const auto found = rows.find(path);
+    if (found == rows.end()) continue;
+    const Summary& now = found->second;
+    if (now.p99 > base.p99 * (1.0 + opt.tolerance)) {
+      std::printf("REGRESSION %s p99 %.1fms > baseline %.1fms\n",
+                  path.c_str(), now.p99, base.p99);
+      ++regressions;
+    }
+    if (now.errorPct > base.errorPct + 1.0) {
+      std::printf("REGRESSION %s errors %.2f%% > baseline %.2f%%\n",
+                  path.c_str(), now.errorPct, base.errorPct);
+      ++regressions;
+    }
+  }
+  if (regressions == 0) std::printf("within baseline (+%.0f%% p99)\n",
+                                    opt.tolerance * 100.0);
+  return regressions == 0 ? 0 : 1;
+}
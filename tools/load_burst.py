@@ -0,0 +1,136 @@
+"""
+Drive the device web server past its admission limits and report how it sheds.
+
+Usage:
+  python tools/load_burst.py --host monitor-server.local
+  python tools/load_burst.py --host 192.168.4.1 --path /api/wifi/scan --levels 1,2,4
+  python tools/load_burst.py --host monitor-server.local --duration 20 --levels 8,16,32
+
+Each level runs that many concurrent clients against --path for --duration
+seconds. Rejections (429 rate limited, 503 busy or low heap) are expected under
+load; what matters is that they come back fast, carry Retry-After, and that the
+device answers /api/state normally again once the burst ends.
+"""
+import argparse
+import http.client
+import statistics
+import sys
+import threading
+import time
+from collections import Counter
+
+
+def percentile(values, pct):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, int(round(pct / 100.0 * (len(ordered) - 1))))
+    return ordered[index]
+
+
+def one_request(host, port, path, timeout):
+    start = time.monotonic()
+    try:
+        conn = http.client.HTTPConnection(host, port, timeout=timeout)
+        conn.request("GET", path, headers={"Connection": "close"})
+        resp = conn.getresponse()
+        resp.read()
+        retry_after = resp.getheader("Retry-After")
+        conn.close()
+        return resp.status, time.monotonic() - start, retry_after
+    except (OSError, http.client.HTTPException):
+        return None, time.monotonic() - start, None
+
+
+def run_level(args, clients):
+    deadline = time.monotonic() + args.duration
+    lock = threading.Lock()
+    codes = Counter()
+    latency = {}
+    missing_retry_after = 0
+
+    def worker():
+        nonlocal missing_retry_after
+        while time.monotonic() < deadline:
+            code, elapsed, retry_after = one_request(
+                args.host, args.port, args.path, args.timeout)
+            key = code if code is not None else "error"
+            with lock:
+                codes[key] += 1
+                latency.setdefault(key, []).append(elapsed * 1000.0)
+                if code in (429, 503) and retry_after is None:
+                    missing_retry_after += 1
+            if args.think_ms:
+                time.sleep(args.think_ms / 1000.0)
+
+    threads = [threading.Thread(target=worker) for _ in range(clients)]
+    started = time.monotonic()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    return codes, latency, missing_retry_after, time.monotonic() - started
+
+
+def wait_recovered(args):
+    deadline = time.monotonic() + args.recovery
+    while time.monotonic() < deadline:
+        code, elapsed, _ = one_request(args.host, args.port, "/api/state",
+                                       args.timeout)
+        if code == 200:
+            return elapsed * 1000.0
+        time.sleep(0.5)
+    return None
+
+
+def describe(label, values):
+    if not values:
+        return f"{label:>8}: -"
+    return (f"{label:>8}: n={len(values):<5} p50={percentile(values, 50):7.1f}ms "
+            f"p99={percentile(values, 99):7.1f}ms max={max(values):7.1f}ms")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", required=True)
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--path", default="/api/state")
+    parser.add_argument("--levels", default="1,4,8,16")
+    parser.add_argument("--duration", type=float, default=10.0)
+    parser.add_argument("--timeout", type=float, default=10.0)
+    parser.add_argument("--think-ms", type=float, default=0.0)
+    parser.add_argument("--recovery", type=float, default=15.0,
+                        help="seconds to wait for /api/state after each level")
+    args = parser.parse_args()
+
+    levels = [int(x) for x in args.levels.split(",") if x.strip()]
+    degraded = False
+    for clients in levels:
+        codes, latency, missing, elapsed = run_level(args, clients)
+        total = sum(codes.values())
+        print(f"\n== {clients} clients, {total} requests in {elapsed:.1f}s "
+              f"({total / elapsed:.1f} req/s) on {args.path}")
+        for key in sorted(codes, key=str):
+            share = 100.0 * codes[key] / total if total else 0.0
+            print(f"{describe(str(key), latency[key])}  ({share:.1f}%)")
+        if missing:
+            print(f"  {missing} rejections without Retry-After")
+            degraded = True
+        if codes.get("error"):
+            degraded = True
+
+        recovered_ms = wait_recovered(args)
+        if recovered_ms is None:
+            print(f"  /api/state did not recover within {args.recovery:.0f}s")
+            degraded = True
+        else:
+            print(f"  /api/state back to 200 in {recovered_ms:.1f}ms")
+        if latency.get(200):
+            print(f"  mean ok latency {statistics.mean(latency[200]):.1f}ms")
+
+    return 1 if degraded else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,102 @@
+"""
+Measure how long the device pages take to become ready, batched vs unbatched.
+
+Usage:
+  python tools/page_ready.py --host 192.168.4.1
+  python tools/page_ready.py --host monitor-server.local --page dashboard --runs 20
+
+Each run fetches the page HTML and then the data it needs, once through a single
+/api/batch request and once the old way with one request per section (issued in
+parallel, as the browser did). Page-ready is the time until the last response
+body is in. Run it from a laptop joined to the device AP to get the AP-mode
+numbers; the pages themselves report the same figure as window.pageReadyMs.
+"""
+import argparse
+import http.client
+import statistics
+import sys
+import threading
+import time
+
+PAGES = {
+    "setup": ("/setup", "wifi,schema,thermal,security,users",
+              ["/api/wifi/scan", "/api/config/schema", "/api/config/thermal",
+               "/api/config/security", "/api/users"]),
+    "dashboard": ("/", "state,thermal", ["/api/state"]),
+}
+
+
+def get(host, port, path, timeout):
+    conn = http.client.HTTPConnection(host, port, timeout=timeout)
+    try:
+        conn.request("GET", path)
+        resp = conn.getresponse()
+        resp.read()
+        return resp.status
+    finally:
+        conn.close()
+
+
+def load(args, html, paths):
+    start = time.monotonic()
+    if get(args.host, args.port, html, args.timeout) != 200:
+        return None
+    statuses = []
+
+    def fetch(path):
+        statuses.append(get(args.host, args.port, path, args.timeout))
+
+    threads = [threading.Thread(target=fetch, args=(p,)) for p in paths]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    if any(code != 200 for code in statuses):
+        return None
+    return (time.monotonic() - start) * 1000.0
+
+
+def summarize(label, samples, failures):
+    if not samples:
+        print(f"{label:>9}: no successful runs ({failures} failed)")
+        return
+    print(f"{label:>9}: n={len(samples):<3} median={statistics.median(samples):7.1f}ms "
+          f"min={min(samples):7.1f}ms max={max(samples):7.1f}ms failed={failures}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", required=True)
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--page", choices=sorted(PAGES), default="setup")
+    parser.add_argument("--runs", type=int, default=10)
+    parser.add_argument("--timeout", type=float, default=10.0)
+    parser.add_argument("--pause", type=float, default=1.0,
+                        help="seconds between runs, keeps the rate limiter out of the way")
+    args = parser.parse_args()
+
+    html, parts, separate = PAGES[args.page]
+    modes = {"batched": [f"/api/batch?r={parts}"], "separate": separate}
+    results = {mode: ([], 0) for mode in modes}
+    for _ in range(args.runs):
+        for mode, paths in modes.items():
+            try:
+                elapsed = load(args, html, paths)
+            except (OSError, http.client.HTTPException):
+                elapsed = None
+            samples, failures = results[mode]
+            if elapsed is None:
+                results[mode] = (samples, failures + 1)
+            else:
+                samples.append(elapsed)
+            time.sleep(args.pause)
+
+    print(f"page-ready for {html} over {args.runs} runs")
+    for mode, (samples, failures) in results.items():
+        summarize(mode, samples, failures)
+    return 0 if all(samples for samples, _ in results.values()) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,155 @@
+"""
+Symbolize a sampling profile from the esp32dev_prof build.
+
+Usage:
+  pio run -e esp32dev_prof -t upload
+  python tools/profile_report.py --host monitor-server.local
+  python tools/profile_report.py --input profile.txt --top 40
+
+The dump comes from GET /api/profile (or --input) and is resolved against
+.pio/build/esp32dev_prof/firmware.elf with addr2line. Pass --reset to clear
+the device histogram after fetching.
+"""
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import urllib.request
+from collections import Counter, defaultdict
+from os.path import dirname, exists, join
+
+PROJECT_DIR = dirname(dirname(os.path.abspath(__file__)))
+DEFAULT_ELF = join(PROJECT_DIR, ".pio", "build", "esp32dev_prof", "firmware.elf")
+BUNDLED_BIN = join(PROJECT_DIR, "tools", "gcc15", "xtensa-esp-elf", "bin")
+
+GROUPS = [
+    ("keypad", ("Keypad::", "Key::")),
+    ("async_tcp", ("AsyncClient", "AsyncServer", "AsyncWebServer", "_async_", "tcp_", "lwip_")),
+    ("arduinojson", ("ArduinoJson",)),
+    ("string", ("String::", "StringSumHelper")),
+    ("tls", ("mbedtls_",)),
+    ("wifi", ("wifi", "esp_wifi", "ieee80211", "pp_", "lmac")),
+    ("idle", ("prvIdleTask", "esp_pm_impl_waiti", "cpu_ll_waiti")),
+]
+
+
+def find_addr2line(explicit):
+    if explicit:
+        return explicit
+    exe = ".exe" if os.name == "nt" else ""
+    bundled = join(BUNDLED_BIN, f"xtensa-esp32-elf-addr2line{exe}")
+    if exists(bundled):
+        return bundled
+    found = shutil.which("xtensa-esp32-elf-addr2line")
+    if not found:
+        sys.exit("xtensa-esp32-elf-addr2line not found, pass --addr2line")
+    return found
+
+
+def load_dump(args):
+    if args.input:
+        with open(args.input, "r", encoding="utf-8") as f:
+            return f.read()
+    url = f"http://{args.host}/api/profile"
+    with urllib.request.urlopen(url, timeout=30) as resp:
+        text = resp.read().decode("utf-8")
+    if args.reset:
+        urllib.request.urlopen(url + "?reset=1", timeout=10).read()
+    return text
+
+
+def parse_dump(text):
+    meta, tasks, samples = {}, {}, []
+    for line in text.splitlines():
+        parts = line.split()
+        if not parts or parts[0].startswith("#"):
+            continue
+        if parts[0] == "task":
+            tasks[int(parts[1])] = (parts[2], int(parts[3]))
+        elif parts[0] == "sample":
+            samples.append((int(parts[1], 16), int(parts[2], 16), int(parts[3]), int(parts[4])))
+        elif len(parts) == 2:
+            meta[parts[0]] = int(parts[1])
+    return meta, tasks, samples
+
+
+def symbolize(addr2line, elf, addresses):
+    addresses = sorted(a for a in addresses if a)
+    names = {0: "<unknown>"}
+    if not addresses:
+        return names
+    cmd = [addr2line, "-f", "-C", "-e", elf] + [hex(a) for a in addresses]
+    out = subprocess.run(cmd, capture_output=True, text=True, check=True).stdout.splitlines()
+    for i, addr in enumerate(addresses):
+        func = out[i * 2] if i * 2 < len(out) else "??"
+        names[addr] = func if func != "??" else f"0x{addr:08x}"
+    return names
+
+
+def group_of(func):
+    for name, needles in GROUPS:
+        if any(n in func for n in needles):
+            return name
+    return "other"
+
+
+def print_table(title, rows, total, top):
+    print(f"\n{title}")
+    print(f"{'samples':>8} {'%':>6}  function")
+    for name, count in rows[:top]:
+        print(f"{count:>8} {100.0 * count / max(total, 1):>5.1f}%  {name}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flat/caller profile from /api/profile")
+    parser.add_argument("--host", default="monitor-server.local")
+    parser.add_argument("--input", help="read a saved dump instead of fetching")
+    parser.add_argument("--elf", default=DEFAULT_ELF)
+    parser.add_argument("--addr2line")
+    parser.add_argument("--top", type=int, default=25)
+    parser.add_argument("--reset", action="store_true")
+    args = parser.parse_args()
+
+    text = load_dump(args)
+    meta, tasks, samples = parse_dump(text)
+    if not exists(args.elf):
+        sys.exit(f"ELF not found: {args.elf}")
+
+    addresses = {pc for pc, _, _, _ in samples} | {caller for _, caller, _, _ in samples}
+    names = symbolize(find_addr2line(args.addr2line), args.elf, addresses)
+
+    total = sum(count for _, _, _, count in samples)
+    flat = Counter()
+    callers = defaultdict(Counter)
+    groups = Counter()
+    per_task = defaultdict(Counter)
+    for pc, caller, task, count in samples:
+        func = names.get(pc, hex(pc))
+        flat[func] += count
+        callers[func][names.get(caller, hex(caller))] += count
+        groups[group_of(func)] += count
+        per_task[tasks.get(task, (str(task), 0))[0]][func] += count
+
+    print(f"{meta.get('samples', total)} samples at {meta.get('hz', 0)} Hz per core, "
+          f"{meta.get('dropped', 0)} dropped (histogram full)")
+
+    print_table("Flat profile (self samples)", flat.most_common(), total, args.top)
+
+    print("\nCaller profile")
+    for func, count in flat.most_common(min(args.top, 10)):
+        print(f"{count:>8}  {func}")
+        for caller, ccount in callers[func].most_common(3):
+            print(f"{'':>10}<- {ccount:>6}  {caller}")
+
+    print_table("By subsystem", groups.most_common(), total, args.top)
+
+    print("\nBy task")
+    for task_id, (name, task_samples) in sorted(tasks.items()):
+        top_func = per_task[name].most_common(1)
+        hot = f"  hottest: {top_func[0][0]}" if top_func else ""
+        print(f"{task_samples:>8}  {name}{hot}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,192 @@
+// Telemetry URL builds per second, String-style concatenation vs. the
+// fixed-buffer RequestBuilder, on the host.
+//
+// Build and run from the repo root:
+//   g++ -std=c++20 -O2 -Iinclude tools/request_bench.cpp -o request_bench
+//   ./request_bench [builds]
+//
+// The legacy path mirrors the old GoogleSheetsClient::sendTelemetry: one
+// heap string grown by += per field, floats printed with two or one
+// decimals, an allocating urlEncode per text field and localtime_r plus
+// strftime for every timestamp. Both paths must produce the same URL; heap
+// allocations are counted by replacing operator new.
+#include "RequestBuilder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace {
+
+size_t s_allocations = 0;
+
+struct Sample {
+  uint32_t epoch;
+  const char* deviceId;
+  int16_t temperatureCenti;
+  uint16_t humidityCenti;
+  bool fan1On;
+  bool fan2On;
+  bool alarm;
+  const char* doorState;
+  int32_t rssi;
+  int16_t warnCenti;
+  int16_t stage2Centi;
+};
+
+constexpr const char* SCRIPT_URL =
+    "https://script.google.com/macros/s/"
+    "AKfycbx0000000000000000000000000000000000000000000000000000000/exec";
+
+std::string urlEncode(const std::string& value) {
+  static const char* kHex = "0123456789ABCDEF";
+  std::string out;
+  out.reserve(value.size() * 3);
+  for (const char ch : value) {
+    const auto c = static_cast<uint8_t>(ch);
+    if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+        (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.' ||
+        c == '~') {
+      out += static_cast<char>(c);
+    } else {
+      out += '%';
+      out += kHex[(c >> 4) & 0x0F];
+      out += kHex[c & 0x0F];
+    }
+  }
+  return out;
+}
+
+// Stands in for Arduino's String(float, decimals).
+std::string floatString(float value, int decimals) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%.*f", decimals, static_cast<double>(value));
+  return buf;
+}
+
+std::string legacyTimestamp(uint32_t epoch) {
+  const time_t now = epoch;
+  struct tm timeinfo;
+  localtime_r(&now, &timeinfo);
+  char buf[32];
+  strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &timeinfo);
+  return buf;
+}
+
+std::string buildLegacy(const Sample& s) {
+  std::string url = SCRIPT_URL;
+  url += "?sheet=telemetry_logs";
+  url += "&timestamp=" + urlEncode(legacyTimestamp(s.epoch));
+  url += "&device_id=" + urlEncode(s.deviceId);
+  url += "&temperature_c=" + floatString(s.temperatureCenti / 100.0f, 2);
+  url += "&humidity_pct=" + floatString(s.humidityCenti / 100.0f, 2);
+  url += "&fan1_on=" + std::string(s.fan1On ? "true" : "false");
+  url += "&fan2_on=" + std::string(s.fan2On ? "true" : "false");
+  url += "&alarm_state=" + std::string(s.alarm ? "ALARM" : "NORMAL");
+  url += "&door_state=" + urlEncode(s.doorState);
+  url += "&wifi_rssi=" + std::to_string(s.rssi);
+  url += "&warn_threshold=" + floatString(s.warnCenti / 100.0f, 1);
+  url += "&stage2_threshold=" + floatString(s.stage2Centi / 100.0f, 1);
+  return url;
+}
+
+template <size_t N>
+void buildFixed(const Sample& s, TimestampCache& cache,
+                RequestBuilder<N>& url) {
+  url.text("sheet", "telemetry_logs")
+      .timestamp("timestamp", s.epoch, 0, cache)
+      .text("device_id", s.deviceId)
+      .fixed("temperature_c", s.temperatureCenti, 2)
+      .fixed("humidity_pct", s.humidityCenti, 2)
+      .boolean("fan1_on", s.fan1On)
+      .boolean("fan2_on", s.fan2On)
+      .text("alarm_state", s.alarm ? "ALARM" : "NORMAL")
+      .text("door_state", s.doorState)
+      .integer("wifi_rssi", s.rssi)
+      .fixed("warn_threshold", divRound(s.warnCenti, 10), 1)
+      .fixed("stage2_threshold", divRound(s.stage2Centi, 10), 1);
+}
+
+Sample sampleAt(uint32_t i) {
+  return {1717200000 + i * 5,
+          "server room #1",
+          static_cast<int16_t>(2300 + i % 700),
+          static_cast<uint16_t>(4500 + i % 1500),
+          (i & 1) != 0,
+          (i & 2) != 0,
+          (i & 4) != 0,
+          (i & 8) != 0 ? "UNLOCKING" : "LOCKED",
+          -40 - static_cast<int32_t>(i % 50),
+          3000,
+          3500};
+}
+
+struct Result {
+  double buildsPerSec;
+  double allocationsPerBuild;
+  size_t checksum;
+};
+
+template <typename Fn>
+Result run(uint32_t builds, Fn&& build) {
+  const size_t allocationsBefore = s_allocations;
+  size_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < builds; ++i) checksum += build(i);
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return {builds / elapsed.count(),
+          static_cast<double>(s_allocations - allocationsBefore) / builds,
+          checksum};
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  ++s_allocations;
+  if (void* p = std::malloc(size)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+  const uint32_t builds =
+      argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 200000;
+
+  TimestampCache cache;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    RequestBuilder<768> url(SCRIPT_URL);
+    buildFixed(sampleAt(i * 97), cache, url);
+    const std::string legacy = buildLegacy(sampleAt(i * 97));
+    if (!url.ok() || legacy != url.c_str()) {
+      std::fprintf(stderr, "mismatch:\n  %s\n  %s\n", legacy.c_str(),
+                   url.c_str());
+      return 1;
+    }
+  }
+
+  const Result legacy = run(builds, [](uint32_t i) {
+    return buildLegacy(sampleAt(i)).size();
+  });
+  const Result fixed = run(builds, [&cache](uint32_t i) {
+    RequestBuilder<768> url(SCRIPT_URL);
+    buildFixed(sampleAt(i), cache, url);
+    return url.length();
+  });
+  if (legacy.checksum != fixed.checksum) {
+    std::fprintf(stderr, "length checksum differs\n");
+    return 1;
+  }
+
+  std::printf("%-16s %14s %16s\n", "builder", "builds/s", "allocs/build");
+  std::printf("%-16s %14.0f %16.1f\n", "String +=", legacy.buildsPerSec,
+              legacy.allocationsPerBuild);
+  std::printf("%-16s %14.0f %16.1f\n", "RequestBuilder", fixed.buildsPerSec,
+              fixed.allocationsPerBuild);
+  std::printf("speedup %.1fx, %u timestamp cache refreshes\n",
+              fixed.buildsPerSec / legacy.buildsPerSec, cache.misses());
+  return 0;
+}
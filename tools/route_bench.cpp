@@ -0,0 +1,113 @@
+// Route lookup cost, trie vs. the old linear handler scan, on the host.
+//
+// Build and run from the repo root:
+//   g++ -std=c++20 -O2 -Iinclude tools/route_bench.cpp -o route_bench
+//   ./route_bench
+//
+// Each table has N synthetic routes shaped like the device's: a few /api
+// groups, one or two segments deep, a quarter of them with a trailing
+// parameter. The linear scan mirrors the per-route handlers the server used
+// to walk: exact match or prefix match on "uri/". Misses are the worst case
+// for both since every candidate is tried.
+#include "RouteTrie.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Def {
+  RouteMethod method;
+  std::string_view pattern;
+};
+
+struct Table {
+  std::vector<std::string> patterns;  // Trie form, with {param} segments.
+  std::vector<std::string> prefixes;  // Handler form, parameters dropped.
+  std::vector<std::string> hits;
+  std::vector<std::string> misses;
+};
+
+Table makeTable(size_t count) {
+  static const char* const GROUPS[] = {"config", "users", "wifi", "audit",
+                                       "sensors", "jobs", "ota", "debug"};
+  Table table;
+  for (size_t i = 0; i < count; ++i) {
+    const std::string base = std::string("/api/") + GROUPS[i % 8] + "/r" +
+                             std::to_string(i / 8);
+    if (i % 4 == 3) {
+      table.patterns.push_back(base + "/{id:uint}");
+      table.hits.push_back(base + "/" + std::to_string(1000 + i));
+    } else {
+      table.patterns.push_back(base);
+      table.hits.push_back(base);
+    }
+    table.prefixes.push_back(base);
+    table.misses.push_back(std::string("/api/") + GROUPS[i % 8] + "/x" +
+                           std::to_string(i));
+  }
+  return table;
+}
+
+bool linearMatch(const std::vector<std::string>& prefixes,
+                 std::string_view path) {
+  for (const std::string& uri : prefixes) {
+    if (path == uri) return true;
+    if (path.size() > uri.size() && path.compare(0, uri.size(), uri) == 0 &&
+        path[uri.size()] == '/') {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename Fn>
+double nsPerLookup(const std::vector<std::string>& paths, Fn&& lookup) {
+  constexpr int ROUNDS = 2000;
+  size_t found = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < ROUNDS; ++round) {
+    for (const std::string& path : paths) found += lookup(path) ? 1 : 0;
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  // Keeps the loop from being optimised away.
+  if (found == SIZE_MAX) std::puts("");
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         (static_cast<double>(ROUNDS) * paths.size());
+}
+
+}  // namespace
+
+int main() {
+  using Trie = RouteTrie<4096>;
+  std::printf("%6s %8s %12s %12s %12s %12s\n", "routes", "nodes", "trie hit",
+              "trie miss", "linear hit", "linear miss");
+  for (size_t count = 8; count <= 256; count *= 2) {
+    const Table table = makeTable(count);
+    std::vector<Def> defs;
+    for (const std::string& pattern : table.patterns) {
+      defs.push_back({RouteMethod::Get, pattern});
+    }
+    const auto trie = std::make_unique<Trie>(defs.data(), defs.size());
+    if (trie->error() != nullptr) {
+      std::fprintf(stderr, "route table: %s\n", trie->error());
+      return 1;
+    }
+    auto trieLookup = [&](const std::string& path) {
+      RouteParams params;
+      return trie->match(RouteMethod::Get, path, params) < Trie::WRONG_METHOD;
+    };
+    auto linearLookup = [&](const std::string& path) {
+      return linearMatch(table.prefixes, path);
+    };
+    std::printf("%6zu %8zu %10.1fns %10.1fns %10.1fns %10.1fns\n", count,
+                trie->nodeCount(), nsPerLookup(table.hits, trieLookup),
+                nsPerLookup(table.misses, trieLookup),
+                nsPerLookup(table.hits, linearLookup),
+                nsPerLookup(table.misses, linearLookup));
+  }
+  return 0;
+}